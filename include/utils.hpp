@@ -8,6 +8,20 @@
 #include <iostream>
 #include <print>
 #include <chrono>
+#include <string_view>
+#include <array>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <optional>
+#include <cstdio>
+
+#ifdef EMBED_INPUT
+#include "embedded_input.hpp" // Generated by "make embed"
+#endif
 
 namespace Util {
 
@@ -23,29 +37,164 @@ struct Day {
     }
 };
 
+// Where solutions and timings are printed: stdout, unless the service is capturing a response
+FILE* Output();
+
+#ifdef ALLOC_STATS
+// Heap usage as counted by the global operator new/delete replacements in utils.cpp
+struct AllocationStats {
+    size_t allocations{0};
+    size_t bytes{0};
+    size_t peakBytes{0}; // Most bytes live at the same time
+};
+
+// Returns the counts since the previous call and starts over. The peak starts over from the bytes live now
+AllocationStats TakeAllocationStats();
+#endif
+
+#ifdef TRACE
+// Adds a span on the calling thread to the trace, which is written as Chrome trace-event JSON on exit
+void RecordTraceSpan(std::string_view name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+#endif
+
+// Scoped span in the trace of builds with TRACE defined. Compiles to nothing otherwise
+class TraceSpan {
+public:
+    explicit TraceSpan([[maybe_unused]] std::string_view name) {
+#ifdef TRACE
+        m_name = name;
+        m_start = std::chrono::steady_clock::now();
+#endif
+    }
+
+    ~TraceSpan() {
+#ifdef TRACE
+        RecordTraceSpan(m_name, m_start, std::chrono::steady_clock::now());
+#endif
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+#ifdef TRACE
+    std::string_view m_name;
+    std::chrono::steady_clock::time_point m_start;
+#endif
+};
+
 class Timer {
 public:
     explicit Timer()
-        : m_start(std::chrono::steady_clock::now()) {}
+        : m_start(std::chrono::steady_clock::now()) {
+        BeginPhase("parse");
+    }
 
     ~Timer() {
+        EndPhase();
         const auto end   = std::chrono::steady_clock::now();
         const auto dur   = end - m_start;
         const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(dur).count();
 
-        std::println("Execution time: {}µs", micros);
+        std::println(Output(), "Execution time: {}µs", micros);
+#ifdef TRACE
+        RecordTraceSpan("total", m_start, end);
+#endif
+#ifdef ALLOC_STATS
+        for (int i = 0; i < m_numPhases; ++i) {
+            const auto& [name, stats] = m_phases[i];
+            std::println(Output(), "Allocations in {}: {} ({} bytes, peak {} bytes)", name, stats.allocations, stats.bytes, stats.peakBytes);
+        }
+#endif
+    }
+
+    // Marks the start of a phase such as "part A". Builds with ALLOC_STATS report heap usage per phase,
+    // and builds with TRACE record each phase as a span
+    void BeginPhase([[maybe_unused]] std::string_view name) {
+        EndPhase();
+#ifdef TRACE
+        m_phaseName = name;
+        m_phaseStart = std::chrono::steady_clock::now();
+#endif
+#ifdef ALLOC_STATS
+        if (m_numPhases < maxPhases) {
+            m_phases[m_numPhases++].first = name;
+        }
+#endif
     }
 
     Timer(const Timer&) = delete;
     Timer& operator=(const Timer&) = delete;
 
 private:
+    void EndPhase() {
+#ifdef TRACE
+        if (!m_phaseName.empty()) {
+            RecordTraceSpan(m_phaseName, m_phaseStart, std::chrono::steady_clock::now());
+            m_phaseName = {};
+        }
+#endif
+#ifdef ALLOC_STATS
+        // Phases beyond maxPhases are added to the last one
+        const AllocationStats taken = TakeAllocationStats();
+        if (m_numPhases > 0) {
+            AllocationStats& stats = m_phases[m_numPhases - 1].second;
+            stats.allocations += taken.allocations;
+            stats.bytes += taken.bytes;
+            stats.peakBytes = std::max(stats.peakBytes, taken.peakBytes);
+        }
+#endif
+    }
+
+#ifdef TRACE
+    std::string_view m_phaseName;
+    std::chrono::steady_clock::time_point m_phaseStart;
+#endif
+#ifdef ALLOC_STATS
+    static constexpr int maxPhases = 8;
+
+    std::array<std::pair<std::string_view, AllocationStats>, maxPhases> m_phases;
+    int m_numPhases{0};
+#endif
     std::chrono::steady_clock::time_point m_start;
 };
 
+#ifdef EMBED_INPUT
+// Input compiled into the binary by "make embed", so its size is known at compile time
+inline constexpr std::string_view embeddedInput{Embedded::input, sizeof(Embedded::input) - 1};
+#endif
+
+// Returns the input for a day if it is already in memory, i.e. embedded by "make embed" or sent as
+// text to the service. Returns nothing if the input has to be read from a file
+std::optional<std::string_view> LoadRawInput(Day day);
+
 // Loads input for given day/part into vector<string>
 std::vector<std::string> LoadInput(Day day);
 
+// Parsed input as structure-of-arrays: a number of integer columns, not necessarily of equal length
+using Columns = std::vector<std::vector<long long>>;
+using InputParser = std::function<Columns(const std::vector<std::string>&)>;
+
+// Columns that are either owned or memory-mapped from the input cache. Cheap to copy
+class ParsedInput {
+public:
+    explicit ParsedInput(Columns columns);
+    ParsedInput(std::shared_ptr<const void> mapping, std::vector<std::span<const long long>> columns);
+
+    size_t NumColumns() const { return m_columns.size(); }
+    std::span<const long long> Column(size_t idx) const { return m_columns.at(idx); }
+
+private:
+    std::shared_ptr<const void> m_storage; // Keeps the owned columns or the mapping alive
+    std::vector<std::span<const long long>> m_columns;
+};
+
+// Loads the parsed input for a day from its binary cache (e.g. "inputs/08.cache") if the cache was
+// written for this exact input file, day and parser version and holds the expected number of
+// columns. Otherwise the text input is parsed and the cache is rewritten. Bump the version whenever
+// the parser's output changes.
+ParsedInput LoadParsedInput(Day day, uint32_t parserVersion, size_t numColumns, const InputParser& parse);
+
 // Splits a string based on a delimiter character
 std::vector<std::string> SplitString(const std::string& str, char splitter);
 
@@ -57,7 +206,11 @@ concept Formattable = requires {
 // Helper for formatting solution to a part
 void ProvideSolution(Formattable auto solution, Part part) {
     const char partChar = (part == Part::A ? 'A' : 'B');
-    std::println("Solution to part {} is: {}", partChar, solution);
+    std::println(Output(), "Solution to part {} is: {}", partChar, solution);
 }
 
+// Entry point of a day. Solves the day's input once, or the given input file. With "--serve" it keeps
+// running and solves every input sent on stdin, or on a Unix socket if a path is given
+int Run(Day day, int argc, char** argv, const std::function<void()>& solve);
+
 } // namespace Util
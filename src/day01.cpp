@@ -39,7 +39,7 @@ int convertLineToDelta(const std::string_view& line) {
     return line[0] == 'L' ? -mag : mag;
 }
 
-int main() {
+void Solve() {
     const auto lines = Util::LoadInput(Util::Day(1));
     Util::Timer t;
     
@@ -52,12 +52,16 @@ int main() {
     std::vector<int> dials(deltas.size());
     std::partial_sum(deltas.begin(), deltas.end(), dials.begin());
 
+    t.BeginPhase("part A");
+
     // Count the dials that show 0 when accounted for modular arithmetic
     int count = std::count_if(dials.begin(), dials.end(), [](auto e) {
         return e % 100 == 0;
     });
     Util::ProvideSolution(count, Util::Part::A);
 
+    t.BeginPhase("part B");
+
     // Count the number of zeroes seen between every pair of dials
     auto pairs = std::views::pairwise(dials);
     std::vector<int> zeroCounts(lines.size());
@@ -71,4 +75,8 @@ int main() {
         std::accumulate(zeroCounts.begin(), zeroCounts.end(), 0),
         Util::Part::B
     );
-}
\ No newline at end of file
+}
+
+int main(int argc, char** argv) {
+    return Util::Run(Util::Day(1), argc, argv, Solve);
+}
@@ -36,7 +36,7 @@ long long dereplicate(long long val, int numCuts) {
     return std::stoll(s);
 }
 
-int main() {
+void Solve() {
     const std::string input = Util::LoadInput(Util::Day(2))[0];
     Util::Timer t;
 
@@ -45,6 +45,8 @@ int main() {
     std::vector<Range> ranges(rangeStrings.size());
     std::transform(rangeStrings.begin(), rangeStrings.end(), ranges.begin(), rangeFromString);
 
+    t.BeginPhase("part A");
+
     constexpr int minCutsAllowed = 2;
     constexpr int maxCutsAllowed = 12;
     std::vector<int> allowedCuts(maxCutsAllowed - minCutsAllowed + 1);
@@ -80,6 +82,8 @@ int main() {
     long long solA = std::accumulate(invalid.front().begin(), invalid.front().end(), 0LL);
     Util::ProvideSolution(solA, Util::Part::A);
 
+    t.BeginPhase("part B");
+
     // B's solution is the sum of invalid IDs with any number of cuts
     std::vector<long long> flat;
     for (auto& v : invalid) flat.insert(flat.end(), v.begin(), v.end());
@@ -88,4 +92,8 @@ int main() {
 
     long long solB = std::accumulate(flat.begin(), it, 0LL);
     Util::ProvideSolution(solB, Util::Part::B);
-}
\ No newline at end of file
+}
+
+int main(int argc, char** argv) {
+    return Util::Run(Util::Day(2), argc, argv, Solve);
+}
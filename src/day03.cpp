@@ -30,10 +30,16 @@ long long computeJolts(const auto lines, int batteries) {
     return std::accumulate(jolts.begin(), jolts.end(), 0LL);
 }
 
-int main() {
+void Solve() {
     const auto lines = Util::LoadInput(Util::Day(3));
     Util::Timer t;
 
+    t.BeginPhase("part A");
     Util::ProvideSolution(computeJolts(lines, 2), Util::Part::A);
+    t.BeginPhase("part B");
     Util::ProvideSolution(computeJolts(lines, 12), Util::Part::B);
 }
+
+int main(int argc, char** argv) {
+    return Util::Run(Util::Day(3), argc, argv, Solve);
+}
@@ -40,13 +40,15 @@ int CountNeighboringPapers(const Sheet& sheet, int r, int c) {
     });
 }
 
-int main() {
+void Solve() {
     auto sheet = Util::LoadInput(Util::Day(4));
     Util::Timer t;
 
     const int rows = std::ssize(sheet);
     const int cols = std::ssize(sheet.front());
 
+    t.BeginPhase("part A");
+
     // First pass: find all initially accessible papers
     int ans = 0;
     std::queue<Tile> candidates;
@@ -62,6 +64,7 @@ int main() {
     }
 
     Util::ProvideSolution(std::ssize(candidates), Util::Part::A);
+    t.BeginPhase("part B");
 
     // Iteratively remove paper rolls add surrounding ones to the queue
     while (!candidates.empty()) {
@@ -86,4 +89,8 @@ int main() {
     }
 
     Util::ProvideSolution(ans, Util::Part::B);
-}
\ No newline at end of file
+}
+
+int main(int argc, char** argv) {
+    return Util::Run(Util::Day(4), argc, argv, Solve);
+}
@@ -14,6 +14,8 @@ Range RangeFromString(const std::string& str) {
 
 // Merges all the ranges so they are non-overlapping
 std::vector<Range> MergeRanges(std::vector<Range>& ranges) {
+    Util::TraceSpan span("MergeRanges");
+
     // Sort ranges based on left end
     std::sort(ranges.begin(), ranges.end(), [](auto& a, auto& b) {
         return a.first < b.first;
@@ -36,17 +38,37 @@ std::vector<Range> MergeRanges(std::vector<Range>& ranges) {
     return merged;
 }
 
-int main() {
-    const auto lines = Util::LoadInput(Util::Day(5));
-    Util::Timer t;
-
+// Parses the input into three columns: range starts, range ends and ingredients
+Util::Columns ParseInput(const std::vector<std::string>& lines) {
     // The blank line splits the ranges from the ingredients
     auto blankLineIt = std::find(lines.begin(), lines.end(), "");
-    std::vector<Range> ranges(blankLineIt - lines.begin());
-    std::vector<long long> ingredients(lines.end() - blankLineIt + 1);
-    std::transform(lines.begin(), blankLineIt, ranges.begin(), RangeFromString);
-    std::transform(blankLineIt + 1, lines.end(), ingredients.begin(), [](auto& s) { return std::stoll(s); });
+    Util::Columns columns(3);
+    std::for_each(lines.begin(), blankLineIt, [&columns](const auto& line) {
+        const auto [lo, hi] = RangeFromString(line);
+        columns[0].push_back(lo);
+        columns[1].push_back(hi);
+    });
+    if (blankLineIt != lines.end()) {
+        std::transform(blankLineIt + 1, lines.end(), std::back_inserter(columns[2]), [](auto& s) { return std::stoll(s); });
+    }
+    return columns;
+}
+
+void Solve() {
+    static constexpr uint32_t parserVersion = 1;
+    static constexpr size_t numColumns = 3;
+    Util::Timer t;
+    const auto input = Util::LoadParsedInput(Util::Day(5), parserVersion, numColumns, ParseInput);
+
+    const auto rangeLos = input.Column(0);
+    const auto rangeHis = input.Column(1);
+    const auto ingredients = input.Column(2);
+    std::vector<Range> ranges(rangeLos.size());
+    std::transform(rangeLos.begin(), rangeLos.end(), rangeHis.begin(), ranges.begin(), [](long long lo, long long hi) {
+        return Range{lo, hi};
+    });
 
+    t.BeginPhase("part A");
     auto mergedRanges = MergeRanges(ranges);
 
     // Count the number of ingredients that lie within any range
@@ -66,8 +88,13 @@ int main() {
     });
 
     Util::ProvideSolution(ans, Util::Part::A);
+    t.BeginPhase("part B");
 
     auto rangeSizes = mergedRanges | std::views::transform([](const Range& range) { return range.second - range.first + 1; });
     auto totalRangeSize = std::accumulate(rangeSizes.begin(), rangeSizes.end(), 0LL);
     Util::ProvideSolution(totalRangeSize, Util::Part::B);
-}
\ No newline at end of file
+}
+
+int main(int argc, char** argv) {
+    return Util::Run(Util::Day(5), argc, argv, Solve);
+}
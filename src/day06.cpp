@@ -58,7 +58,7 @@ bool containsOnlySpaces(const std::string& col) {
     }); 
 }
 
-int main() {
+void Solve() {
     auto rows = Util::LoadInput(Util::Day(6));
     Util::Timer t;
 
@@ -77,14 +77,20 @@ int main() {
         lastBlankLine = blankLine + 1;
     }while (true);
 
+    t.BeginPhase("part A");
     std::vector<long long> solutionsA, solutionsB;
     std::transform(problems.begin(), problems.end(), std::back_inserter(solutionsA), [](const auto& problem) {
         return problem.SolveA();
     });
+    t.BeginPhase("part B");
     std::transform(problems.begin(), problems.end(), std::back_inserter(solutionsB), [](const auto& problem) {
         return problem.SolveB();
     });
     
     Util::ProvideSolution(std::accumulate(solutionsA.begin(), solutionsA.end(), 0LL), Util::Part::A);
     Util::ProvideSolution(std::accumulate(solutionsB.begin(), solutionsB.end(), 0LL), Util::Part::B);
-}
\ No newline at end of file
+}
+
+int main(int argc, char** argv) {
+    return Util::Run(Util::Day(6), argc, argv, Solve);
+}
@@ -18,7 +18,8 @@ std::vector<long long> computeNextRow(const std::vector<long long>& lastRow, con
     return newNextRow;
 }
 
-int main() {
+void Solve() {
+    splitCount = 0; // Solve can run several times in service mode
     auto lines = Util::LoadInput(Util::Day(7));
     Util::Timer t;
 
@@ -39,9 +40,15 @@ int main() {
         return row;
     });
 
+    // Both parts come out of the same pass over the grid
+    t.BeginPhase("parts A and B");
     auto lastRow = std::accumulate(grid.begin() + 1, grid.end(), grid.front(), computeNextRow);
     auto numTimelines = std::accumulate(lastRow.begin(), lastRow.end(), 0LL);
     
     Util::ProvideSolution(splitCount, Util::Part::A);
     Util::ProvideSolution(numTimelines, Util::Part::B);
 }
+
+int main(int argc, char** argv) {
+    return Util::Run(Util::Day(7), argc, argv, Solve);
+}
@@ -6,10 +6,13 @@
 #include <cmath>
 #include <numeric>
 #include <array>
+#include <bit>
 
 struct Point {
     int x, y, z, id;
 
+    Point(int x, int y, int z, int id) : x(x), y(y), z(z), id(id) {}
+
     Point(std::string description, int id) : id(id) {
         std::stringstream ss{description};
         std::string token;
@@ -22,19 +25,95 @@ struct Point {
     }
 };
 
-struct UnionFind {
-	std::vector<int> e;
-	UnionFind(int n) : e(n, 1) {}
-	bool sameSet(int a, int b) { return find(a) == find(b); }
-	int size(int x) { return e[-find(x)]; }
-	int find(int x) { return e[x] > 0 ? -x : e[x] = find(-e[x]); }
-	bool join(int a, int b) {
-		a = -find(a), b = -find(b);
-		if (a == b) return false;
-		if (e[a] < e[b]) std::swap(a, b);
-		e[a] += e[b]; e[b] = -a;
-		return true;
-	}
+// Number of components of each size, as a Fenwick tree so order statistics take O(log n)
+class SizeHistogram {
+public:
+    explicit SizeHistogram(int maxSize) : m_tree(maxSize + 1, 0) {}
+
+    void Add(int size, int delta) {
+        m_total += delta;
+        for (; size < std::ssize(m_tree); size += size & -size) {
+            m_tree[size] += delta;
+        }
+    }
+
+    // Size of the k:th largest component (1-based), or 0 if there are fewer than k components
+    int KthLargest(int k) const {
+        if (k > m_total) {
+            return 0;
+        }
+        // Descend the tree looking for the (total - k + 1):th smallest size
+        int rank = m_total - k + 1;
+        int pos{0};
+        for (int step = std::bit_floor(m_tree.size() - 1); step > 0; step >>= 1) {
+            if (pos + step < std::ssize(m_tree) && m_tree[pos + step] < rank) {
+                pos += step;
+                rank -= m_tree[pos];
+            }
+        }
+        return pos + 1;
+    }
+
+    int Total() const { return m_total; }
+
+private:
+    std::vector<int> m_tree;
+    int m_total{0};
+};
+
+// Union-find that keeps track of component sizes as they merge, so the largest components can be
+// queried in O(1) after any number of joins
+class UnionFind {
+public:
+    static constexpr int numLargest = 3;
+
+    explicit UnionFind(int n) : m_parent(n), m_size(n, 1), m_histogram(n) {
+        std::iota(m_parent.begin(), m_parent.end(), 0);
+        m_histogram.Add(1, n);
+        UpdateLargest();
+    }
+
+    int Find(int x) {
+        // Path halving: point every other node on the way up to its grandparent
+        while (m_parent[x] != x) {
+            m_parent[x] = m_parent[m_parent[x]];
+            x = m_parent[x];
+        }
+        return x;
+    }
+
+    bool Join(int a, int b) {
+        a = Find(a), b = Find(b);
+        if (a == b) return false;
+        if (m_size[a] < m_size[b]) std::swap(a, b);
+
+        m_histogram.Add(m_size[a], -1);
+        m_histogram.Add(m_size[b], -1);
+        m_parent[b] = a;
+        m_size[a] += m_size[b];
+        m_histogram.Add(m_size[a], 1);
+        UpdateLargest();
+        return true;
+    }
+
+    int Size(int x) { return m_size[Find(x)]; }
+    int NumComponents() const { return m_histogram.Total(); }
+
+    // Product of the sizes of the numLargest largest components
+    long long ProductOfLargest() const { return m_productOfLargest; }
+
+private:
+    void UpdateLargest() {
+        m_productOfLargest = 1;
+        for (int k{1}; k <= numLargest && k <= m_histogram.Total(); ++k) {
+            m_productOfLargest *= m_histogram.KthLargest(k);
+        }
+    }
+
+    std::vector<int> m_parent;
+    std::vector<int> m_size;
+    SizeHistogram m_histogram;
+    long long m_productOfLargest{1};
 };
 
 double DistBetweenPoints(const auto& pointPair) {
@@ -46,21 +125,34 @@ double DistBetweenPoints(const auto& pointPair) {
     );
 }
 
-long long GetProductOfLargestThreeValues(const std::vector<int>& list) {
-    std::array<int, 3> top;
-    std::partial_sort_copy(list.begin(), list.end(), top.begin(), top.end(), std::greater<int>());
-    return std::accumulate(top.begin(), top.end(), 1LL, std::multiplies<int>());
+// Parses the input into columns of x, y and z coordinates
+Util::Columns ParseInput(const std::vector<std::string>& lines) {
+    Util::Columns columns(3);
+    for (const auto& line : lines) {
+        Point point(line, 0);
+        columns[0].push_back(point.x);
+        columns[1].push_back(point.y);
+        columns[2].push_back(point.z);
+    }
+    return columns;
 }
 
-int main() {
-    auto lines = Util::LoadInput(Util::Day(8));
+void Solve() {
+    static constexpr uint32_t parserVersion = 1;
+    static constexpr size_t numColumns = 3;
     Util::Timer t;
+    const auto input = Util::LoadParsedInput(Util::Day(8), parserVersion, numColumns, ParseInput);
 
     // Create a list of points from input
+    const auto xs = input.Column(0);
+    const auto ys = input.Column(1);
+    const auto zs = input.Column(2);
     std::vector<Point> points;
-    std::transform(lines.begin(), lines.end(), std::back_inserter(points), [&points](auto line) {
-        return Point(line, std::ssize(points)); // Give each point a unique id
-    });
+    for (int i = 0; i < std::ssize(xs); i++) {
+        points.emplace_back(xs[i], ys[i], zs[i], i); // Give each point a unique id
+    }
+
+    t.BeginPhase("part A");
 
     // Pair up all points
     std::vector<std::pair<Point, Point>> pointPairs;
@@ -77,20 +169,25 @@ int main() {
     });
 
     // Connect pairs of points one by one
-    UnionFind uf(std::ssize(lines));
+    UnionFind uf(std::ssize(points));
     for (int i = 0; true; i++) {
         if (i == 1000) {
             // At the 1000:th connection, find the largest three unions
-            Util::ProvideSolution(GetProductOfLargestThreeValues(uf.e), Util::Part::A);
+            Util::ProvideSolution(uf.ProductOfLargest(), Util::Part::A);
+            t.BeginPhase("part B");
         }
 
         const auto& [pointA, pointB] = pointPairs[i];
-        uf.join(pointA.id, pointB.id);
+        uf.Join(pointA.id, pointB.id);
 
         // Check if the union is full
-        if (uf.size(0) == std::ssize(lines)) {
+        if (uf.NumComponents() == 1) {
             Util::ProvideSolution((long long)pointA.x * pointB.x, Util::Part::B);
             break;
         }
     }
-}
\ No newline at end of file
+}
+
+int main(int argc, char** argv) {
+    return Util::Run(Util::Day(8), argc, argv, Solve);
+}
@@ -1,5 +1,12 @@
 #include "utils.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+
 struct Point {
     long long x, y;
 };
@@ -11,86 +18,389 @@ long long ComputeArea(const PointPair& rect) {
     return (std::abs(p2.x - p1.x) + 1) * (std::abs(p2.y - p1.y) + 1);
 }
 
-std::vector<PointPair> PairUpAndSortByArea(const auto& points) {
-    // Pair up all points
-    std::vector<PointPair> pointPairs;
-    for (auto it = points.begin(); it != points.end(); ++it) {
-        for (auto jt = std::next(it); jt != points.end(); ++jt) {
-            pointPairs.emplace_back(*it, *jt);
+// Returns the points that are not dominated in the direction (dirX, dirY), i.e. no other point
+// lies further out in both x and y. These form a monotone staircase on the shape's outline.
+std::vector<Point> GetParetoFrontier(const std::vector<Point>& points, int dirX, int dirY) {
+    std::vector<Point> sorted = points;
+    std::sort(sorted.begin(), sorted.end(), [dirX, dirY](const Point& a, const Point& b) {
+        if (a.x != b.x) return dirX * a.x > dirX * b.x;
+        return dirY * a.y > dirY * b.y;
+    });
+
+    std::vector<Point> frontier;
+    for (const Point& point : sorted) {
+        if (frontier.empty() || dirY * point.y > dirY * frontier.back().y) {
+            frontier.push_back(point);
         }
     }
+    return frontier;
+}
 
-    // Sort rectangles by largest area
-    std::sort(pointPairs.begin(), pointPairs.end(), [](const auto& rect1, const auto& rect2) {
-        return ComputeArea(rect1) > ComputeArea(rect2);
-    });
-
-    return pointPairs;
+// Finds the largest rectangle spanned by any two points. One corner of the optimal rectangle can
+// always be pushed out to a frontier point in its direction and the opposite corner to the
+// opposite frontier, so only frontier pairs need to be considered.
+long long FindLargestArea(const std::vector<Point>& points) {
+    Util::TraceSpan span("FindLargestArea");
+    long long best = 0;
+    auto checkFrontiers = [&best](const std::vector<Point>& frontier1, const std::vector<Point>& frontier2) {
+        for (const Point& p1 : frontier1) {
+            for (const Point& p2 : frontier2) {
+                best = std::max(best, ComputeArea({p1, p2}));
+            }
+        }
+    };
+    checkFrontiers(GetParetoFrontier(points, 1, 1), GetParetoFrontier(points, -1, -1));
+    checkFrontiers(GetParetoFrontier(points, 1, -1), GetParetoFrontier(points, -1, 1));
+    return best;
 }
 
-bool DoLinesIntersect(const PointPair& line1, const PointPair& line2) {
-    auto [min1X, max1X] = std::minmax(line1.first.x, line1.second.x);
-    auto [min2X, max2X] = std::minmax(line2.first.x, line2.second.x);
-    auto [min1Y, max1Y] = std::minmax(line1.first.y, line1.second.y);
-    auto [min2Y, max2Y] = std::minmax(line2.first.y, line2.second.y);
-    if (max1X < min2X || min1X > max2X) {
-        return false;
+// Yields the rectangles spanned by all pairs of points in decreasing area order, without ever
+// materializing the n(n-1)/2 pairs. Each anchor point i owns the pairs (i, j) with j > i. An anchor
+// enters the heap keyed by an upper bound on its areas and only builds its candidate list once that
+// bound reaches the top. Candidate lists are kept as sorted chunks that are refilled on demand and
+// double in size each time. Draining an anchor costs O(n log n), memory stays within O(n) plus twice
+// the number of rectangles yielded, and anchors that can never produce the next rectangle are never
+// scanned.
+// The enumerator can be restricted to every stride:th anchor starting at firstAnchor, so several
+// enumerators together cover all pairs exactly once.
+class RectangleEnumerator {
+public:
+    explicit RectangleEnumerator(const std::vector<Point>& points, int firstAnchor = 0, int stride = 1)
+        : m_points(points)
+        , m_anchors(points.size())
+        , m_suffixMin(points.size())
+        , m_suffixMax(points.size())
+    {
+        for (int i = std::ssize(points) - 2; i >= 0; --i) {
+            const Point& next = points[i + 1];
+            m_suffixMin[i] = next;
+            m_suffixMax[i] = next;
+            if (i + 2 < std::ssize(points)) {
+                m_suffixMin[i] = {std::min(next.x, m_suffixMin[i + 1].x), std::min(next.y, m_suffixMin[i + 1].y)};
+                m_suffixMax[i] = {std::max(next.x, m_suffixMax[i + 1].x), std::max(next.y, m_suffixMax[i + 1].y)};
+            }
+            if (i >= firstAnchor && (i - firstAnchor) % stride == 0) {
+                m_heap.push({ComputeAreaBound(i), i});
+            }
+        }
+    }
+
+    // Upper bound on the area of the next rectangle, or 0 once all pairs have been yielded
+    long long PeekAreaBound() const {
+        return m_heap.empty() ? 0 : m_heap.top().area;
+    }
+
+    // Returns the next largest rectangle, or nothing once all pairs have been yielded
+    std::optional<PointPair> Next() {
+        while (!m_heap.empty()) {
+            auto [area, anchorIdx] = m_heap.top();
+            m_heap.pop();
+
+            Anchor& anchor = m_anchors[anchorIdx];
+            if (anchor.cursor == anchor.candidates.size()) {
+                // Either the anchor was only represented by its bound, or its chunk ran out
+                if (!Refill(anchorIdx)) {
+                    continue;
+                }
+                m_heap.push({anchor.candidates.front().area, anchorIdx});
+                continue;
+            }
+
+            const Candidate candidate = anchor.candidates[anchor.cursor++];
+            if (anchor.cursor < anchor.candidates.size()) {
+                m_heap.push({anchor.candidates[anchor.cursor].area, anchorIdx});
+            }else if (Refill(anchorIdx)) {
+                m_heap.push({anchor.candidates.front().area, anchorIdx});
+            }
+            return PointPair{m_points[anchorIdx], m_points[candidate.partner]};
+        }
+        return std::nullopt;
+    }
+
+private:
+    static constexpr size_t initialChunkSize = 16;
+
+    struct Candidate {
+        long long area;
+        int partner;
+
+        // Candidates are yielded by decreasing area, ties broken by partner index
+        bool operator<(const Candidate& rhs) const {
+            return area != rhs.area ? area > rhs.area : partner < rhs.partner;
+        }
+    };
+
+    struct Anchor {
+        std::vector<Candidate> candidates;
+        size_t cursor = 0;
+        size_t chunkSize = initialChunkSize; // Doubles on every refill so deep anchors rescan O(log n) times
+        bool started = false;
+    };
+
+    struct HeapEntry {
+        long long area;
+        int anchorIdx;
+
+        bool operator<(const HeapEntry& rhs) const {
+            return area < rhs.area;
+        }
+    };
+
+    long long ComputeAreaBound(int anchorIdx) const {
+        const Point& p = m_points[anchorIdx];
+        long long width = std::max(std::abs(p.x - m_suffixMin[anchorIdx].x), std::abs(p.x - m_suffixMax[anchorIdx].x));
+        long long height = std::max(std::abs(p.y - m_suffixMin[anchorIdx].y), std::abs(p.y - m_suffixMax[anchorIdx].y));
+        return (width + 1) * (height + 1);
+    }
+
+    // Loads the next chunk of candidates for an anchor, i.e. those ordered after the last one
+    // yielded. Returns false when the anchor has no candidates left.
+    bool Refill(int anchorIdx) {
+        Anchor& anchor = m_anchors[anchorIdx];
+        std::optional<Candidate> last;
+        if (anchor.started) {
+            if (anchor.candidates.size() < anchor.chunkSize) {
+                anchor.candidates.clear();
+                anchor.cursor = 0;
+                return false; // The previous chunk already held everything that was left
+            }
+            last = anchor.candidates.back();
+            anchor.chunkSize *= 2;
+        }
+
+        m_scratch.clear();
+        for (int j = anchorIdx + 1; j < std::ssize(m_points); ++j) {
+            Candidate candidate{ComputeArea({m_points[anchorIdx], m_points[j]}), j};
+            if (!last || *last < candidate) {
+                m_scratch.push_back(candidate);
+            }
+        }
+
+        size_t count = std::min(anchor.chunkSize, m_scratch.size());
+        std::nth_element(m_scratch.begin(), m_scratch.begin() + count - (count > 0), m_scratch.end());
+        std::sort(m_scratch.begin(), m_scratch.begin() + count);
+        anchor.candidates.assign(m_scratch.begin(), m_scratch.begin() + count);
+        anchor.cursor = 0;
+        anchor.started = true;
+        return count > 0;
+    }
+
+    const std::vector<Point>& m_points;
+    std::vector<Anchor> m_anchors;
+    std::vector<Point> m_suffixMin, m_suffixMax; // Bounding box of points[i + 1..]
+    std::priority_queue<HeapEntry> m_heap;
+    std::vector<Candidate> m_scratch;
+};
+
+// Static index over segments that share one axis: each segment has a fixed key coordinate and a
+// span [lo, hi] along the other axis. Segments are sorted by key and stored as structure-of-arrays,
+// and a merge-sort tree over that order answers "does any segment with key in [keyMin, keyMax] have
+// a span overlapping [lo, hi]" in O(log^2 n) without visiting segments outside the key band.
+class SegmentBand {
+public:
+    struct Segment {
+        long long key, lo, hi;
+    };
+
+    explicit SegmentBand(std::vector<Segment> segments) {
+        std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) {
+            return a.key < b.key;
+        });
+        const int n = std::ssize(segments);
+        m_keys.resize(n);
+        std::transform(segments.begin(), segments.end(), m_keys.begin(), [](const Segment& s) { return s.key; });
+
+        // Level k of the tree holds blocks of 2^k consecutive segments, each sorted by lo,
+        // alongside the running maximum of hi within the block
+        std::vector<std::pair<long long, long long>> block;
+        for (int width = 1; width < 2 * n; width *= 2) {
+            auto& los = m_levelLos.emplace_back(n);
+            auto& maxHis = m_levelMaxHis.emplace_back(n);
+            for (int start = 0; start < n; start += width) {
+                int end = std::min(n, start + width);
+                block.clear();
+                for (int i = start; i < end; ++i) {
+                    block.emplace_back(segments[i].lo, segments[i].hi);
+                }
+                std::sort(block.begin(), block.end());
+                long long maxHi = block.front().second;
+                for (int i = start; i < end; ++i) {
+                    maxHi = std::max(maxHi, block[i - start].second);
+                    los[i] = block[i - start].first;
+                    maxHis[i] = maxHi;
+                }
+            }
+        }
     }
-    if (max1Y < min2Y || min1Y > max2Y) {
+
+    bool AnyOverlap(long long keyMin, long long keyMax, long long lo, long long hi) const {
+        int from = std::lower_bound(m_keys.begin(), m_keys.end(), keyMin) - m_keys.begin();
+        int to = std::upper_bound(m_keys.begin(), m_keys.end(), keyMax) - m_keys.begin();
+
+        // Cover [from, to) with the largest aligned blocks available
+        while (from < to) {
+            int level = 0;
+            while (level + 1 < std::ssize(m_levelLos) && from % (2 << level) == 0 && from + (2 << level) <= to) {
+                ++level;
+            }
+            const int end = from + (1 << level);
+
+            // Among the spans in this block starting at or before hi, check if any reaches lo
+            const auto& los = m_levelLos[level];
+            auto it = std::upper_bound(los.begin() + from, los.begin() + end, hi);
+            if (it != los.begin() + from && m_levelMaxHis[level][it - los.begin() - 1] >= lo) {
+                return true;
+            }
+            from = end;
+        }
         return false;
     }
-    return true;
-}
 
-bool DoesLineIntersectInputShape(const PointPair& line, const std::vector<Point>& points) {
+private:
+    std::vector<long long> m_keys;
+    std::vector<std::vector<long long>> m_levelLos, m_levelMaxHis;
+};
+
+// Answers whether a query segment touches any segment of a set of axis-aligned segments, e.g. the
+// edges of a rectilinear polygon. Touching is inclusive: sharing a single point counts.
+class AxisSegmentIndex {
+public:
+    explicit AxisSegmentIndex(const std::vector<PointPair>& segments)
+        : m_horizontal(CollectSegments(segments, true))
+        , m_vertical(CollectSegments(segments, false))
+    {}
+
+    bool Intersects(const PointPair& line) const {
+        auto [minX, maxX] = std::minmax(line.first.x, line.second.x);
+        auto [minY, maxY] = std::minmax(line.first.y, line.second.y);
+        return m_horizontal.AnyOverlap(minY, maxY, minX, maxX) || m_vertical.AnyOverlap(minX, maxX, minY, maxY);
+    }
+
+private:
+    static std::vector<SegmentBand::Segment> CollectSegments(const std::vector<PointPair>& segments, bool horizontal) {
+        std::vector<SegmentBand::Segment> collected;
+        for (const auto& [p1, p2] : segments) {
+            if (p1.x != p2.x && p1.y != p2.y) {
+                throw std::invalid_argument("Segment is not axis-aligned");
+            }
+            if (horizontal && p1.y == p2.y) {
+                auto [lo, hi] = std::minmax(p1.x, p2.x);
+                collected.push_back({p1.y, lo, hi});
+            }else if (!horizontal && p1.y != p2.y) {
+                auto [lo, hi] = std::minmax(p1.y, p2.y);
+                collected.push_back({p1.x, lo, hi});
+            }
+        }
+        return collected;
+    }
+
+    SegmentBand m_horizontal; // Keyed by y, spanning x
+    SegmentBand m_vertical;   // Keyed by x, spanning y
+};
+
+std::vector<PointPair> GetPolygonEdges(const std::vector<Point>& points) {
+    std::vector<PointPair> edges;
     for (int i = 0; i < std::ssize(points); ++i) {
         int j = (i == std::ssize(points) - 1) ? 0 : i + 1; // j = (i + 1) mod #points
-        if (DoLinesIntersect(line, {points[i], points[j]})) {
-            return true;
+        edges.emplace_back(points[i], points[j]);
+    }
+    return edges;
+}
+
+// Checks if a rectangle spanned by two corners only contains tiles inside the shape
+bool IsInsideShape(const AxisSegmentIndex& shapeEdges, const PointPair& rectangle) {
+    // Idea: Shrink rectangle by 1. If this rectangle doesn't intersect with any edge of the input shape,
+    // expanding it again will be safe (meaning it will only contain red/green tiles).
+    const auto& [p1, p2] = rectangle;
+    auto [minX, maxX] = std::minmax(p1.x, p2.x);
+    auto [minY, maxY] = std::minmax(p1.y, p2.y);
+
+    // It's enough to only check the rectangle borders (4 lines)
+    PointPair horizLine1{{minX + 1, minY + 1}, {maxX - 1, minY + 1}};
+    PointPair horizLine2{{minX + 1, maxY - 1}, {maxX - 1, maxY - 1}};
+    PointPair vertiLine1{{minX + 1, minY + 1}, {minX + 1, maxY - 1}};
+    PointPair vertiLine2{{maxX - 1, minY + 1}, {maxX - 1, maxY - 1}};
+
+    return !shapeEdges.Intersects(horizLine1)
+        && !shapeEdges.Intersects(horizLine2)
+        && !shapeEdges.Intersects(vertiLine1)
+        && !shapeEdges.Intersects(vertiLine2);
+}
+
+// Finds the largest rectangle inside the shape. Anchors are dealt out round-robin to the threads,
+// which balances the work since early anchors have the most partners. Each thread walks its own
+// rectangles by decreasing area and stops at its first hit, or once its bound can't beat the best
+// area any thread has found so far.
+long long FindLargestInsideArea(const std::vector<Point>& points, const AxisSegmentIndex& shapeEdges, int numThreads) {
+    std::atomic<long long> best{0};
+    auto search = [&](int firstAnchor) {
+        Util::TraceSpan span("RectangleSearch");
+        RectangleEnumerator rectangles(points, firstAnchor, numThreads);
+        while (rectangles.PeekAreaBound() > best.load(std::memory_order_relaxed)) {
+            auto rectangle = rectangles.Next();
+            if (!rectangle) {
+                break;
+            }
+            if (IsInsideShape(shapeEdges, *rectangle)) {
+                long long area = ComputeArea(*rectangle);
+                long long current = best.load(std::memory_order_relaxed);
+                while (area > current && !best.compare_exchange_weak(current, area, std::memory_order_relaxed)) {}
+                break;
+            }
         }
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        for (int i = 1; i < numThreads; ++i) {
+            workers.emplace_back(search, i);
+        }
+        search(0);
+    }
+    return best.load();
+}
+
+int ChooseThreadCount(const std::vector<Point>& points) {
+    static constexpr int minPointsPerThread = 256;
+    int hardwareThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    return std::clamp(static_cast<int>(std::ssize(points)) / minPointsPerThread, 1, hardwareThreads);
+}
+
+// Parses the input into columns of x and y coordinates
+Util::Columns ParseInput(const std::vector<std::string>& lines) {
+    Util::Columns columns(2);
+    for (const auto& line : lines) {
+        auto comma = line.find(',');
+        columns[0].push_back(std::stoll(line.substr(0, comma)));
+        columns[1].push_back(std::stoll(line.substr(comma + 1)));
     }
-    return false;
+    return columns;
 }
 
-int main() {
-    auto lines = Util::LoadInput(Util::Day(9));
+void Solve() {
+    static constexpr uint32_t parserVersion = 1;
+    static constexpr size_t numColumns = 2;
     Util::Timer t;
+    const auto input = Util::LoadParsedInput(Util::Day(9), parserVersion, numColumns, ParseInput);
 
     // Create a list of points from input
-    std::vector<Point> points;
-    std::transform(lines.begin(), lines.end(), std::back_inserter(points), [](auto line) {
-        auto comma = line.find(',');
-        long long x = std::stoll(line.substr(0, comma));
-        long long y = std::stoll(line.substr(comma + 1));
+    const auto xs = input.Column(0);
+    const auto ys = input.Column(1);
+    std::vector<Point> points(xs.size());
+    std::transform(xs.begin(), xs.end(), ys.begin(), points.begin(), [](long long x, long long y) {
         return Point{x, y};
     });
 
-    auto rectangles = PairUpAndSortByArea(points);
-
-    // Since rectangles are ordered by area (decreasing), pick the first one
-    long long answerA = ComputeArea(rectangles.front());
+    t.BeginPhase("part A");
+    long long answerA = FindLargestArea(points);
     Util::ProvideSolution(answerA, Util::Part::A);
 
-    for (const auto& rectangle : rectangles) {
-        // Idea: Shrink rectangle by 1. If this rectangle doesn't intersect with any edge of the input shape,
-        // expanding it again will be safe (meaning it will only contain red/green tiles).
-        const auto& [p1, p2] = rectangle;
-        auto [minX, maxX] = std::minmax(p1.x, p2.x);
-        auto [minY, maxY] = std::minmax(p1.y, p2.y);
-
-        // It's enough to only check the rectangle borders (4 lines)
-        PointPair horizLine1{{minX + 1, minY + 1}, {maxX - 1, minY + 1}};
-        PointPair horizLine2{{minX + 1, maxY - 1}, {maxX - 1, maxY - 1}};
-        PointPair vertiLine1{{minX + 1, minY + 1}, {minX + 1, maxY - 1}};
-        PointPair vertiLine2{{maxX - 1, minY + 1}, {maxX - 1, maxY - 1}};
-
-        if (DoesLineIntersectInputShape(horizLine1, points)) continue;
-        if (DoesLineIntersectInputShape(horizLine2, points)) continue;
-        if (DoesLineIntersectInputShape(vertiLine1, points)) continue;
-        if (DoesLineIntersectInputShape(vertiLine2, points)) continue;
-
-        // Successful candidate. Pick first and break since rectangles are ordered by area
-        Util::ProvideSolution(ComputeArea(rectangle), Util::Part::B);
-        break;
-    }
+    t.BeginPhase("part B");
+    AxisSegmentIndex shapeEdges(GetPolygonEdges(points));
+    long long answerB = FindLargestInsideArea(points, shapeEdges, ChooseThreadCount(points));
+    Util::ProvideSolution(answerB, Util::Part::B);
+}
+
+int main(int argc, char** argv) {
+    return Util::Run(Util::Day(9), argc, argv, Solve);
 }
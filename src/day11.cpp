@@ -1,76 +1,415 @@
 #include "utils.hpp"
 
-#include <unordered_map>
-#include <unordered_set>
-
-using Node = std::string;
-using Graph = std::unordered_map<Node, std::vector<Node>>;
-using Cache = std::unordered_map<Node, long long>;
-
-static constexpr Node inNode("you");
-static constexpr Node outNode("out");
-static constexpr Node fftNode("fft");
-static constexpr Node dacNode("dac");
-static constexpr Node svrNode("svr");
-
-std::pair<Node, std::vector<Node>> CreateNode(std::string line) {
-    auto colon = line.find(':');
-    auto from = line.substr(0, colon);
-    auto tos = Util::SplitString(line.substr(colon + 2), ' ');
-    return std::make_pair(from, tos);
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <exception>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+using NodeId = int;
+
+static constexpr std::string_view inNode("you");
+static constexpr std::string_view outNode("out");
+static constexpr std::string_view fftNode("fft");
+static constexpr std::string_view dacNode("dac");
+static constexpr std::string_view svrNode("svr");
+
+// Device names are three lowercase letters, so every possible name has a slot in a 26^3 table
+// that maps it to a dense id, handed out in order of first appearance
+class NodeInterner {
+public:
+    NodeInterner() {
+        m_ids.fill(-1);
+    }
+
+    NodeId Intern(std::string_view name) {
+        NodeId& id = m_ids[Slot(name)];
+        if (id == -1) {
+            id = m_numNodes++;
+        }
+        return id;
+    }
+
+    std::optional<NodeId> Find(std::string_view name) const {
+        NodeId id = m_ids[Slot(name)];
+        return id == -1 ? std::nullopt : std::optional<NodeId>(id);
+    }
+
+    int Size() const {
+        return m_numNodes;
+    }
+
+private:
+    static constexpr int alphabetSize = 26;
+    static constexpr int nameLength = 3;
+
+    static int Slot(std::string_view name) {
+        if (name.size() != nameLength) {
+            throw std::invalid_argument(std::format("Invalid device name '{}'", name));
+        }
+        int slot = 0;
+        for (char c : name) {
+            if (c < 'a' || c > 'z') {
+                throw std::invalid_argument(std::format("Invalid device name '{}'", name));
+            }
+            slot = slot * alphabetSize + (c - 'a');
+        }
+        return slot;
+    }
+
+    std::array<NodeId, alphabetSize * alphabetSize * alphabetSize> m_ids;
+    int m_numNodes = 0;
+};
+
+// Adjacency in compressed sparse row form: the neighbors of node i are
+// targets[offsets[i]] up to (but not including) targets[offsets[i + 1]]
+struct CsrGraph {
+    std::vector<int> offsets;
+    std::vector<NodeId> targets;
+
+    CsrGraph(int numNodes, const std::vector<std::pair<NodeId, NodeId>>& edges)
+        : offsets(numNodes + 1, 0)
+        , targets(edges.size())
+    {
+        for (const auto& [from, to] : edges) {
+            offsets[from + 1]++;
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+        for (const auto& [from, to] : edges) {
+            targets[fill[from]++] = to;
+        }
+    }
+
+    int NumNodes() const {
+        return std::ssize(offsets) - 1;
+    }
+
+    std::span<const NodeId> Neighbors(NodeId node) const {
+        return std::span<const NodeId>(targets.data() + offsets[node], targets.data() + offsets[node + 1]);
+    }
+};
+
+struct DeviceGraph {
+    NodeInterner names;
+    CsrGraph forward;
+    CsrGraph reverse;
+};
+
+DeviceGraph BuildDeviceGraph(const std::vector<std::string>& lines) {
+    NodeInterner names;
+    std::vector<std::pair<NodeId, NodeId>> edges;
+    std::vector<std::pair<NodeId, NodeId>> reverseEdges;
+    for (std::string_view line : lines) {
+        auto colon = line.find(':');
+        NodeId from = names.Intern(line.substr(0, colon));
+        for (auto token : line.substr(colon + 1) | std::views::split(' ')) {
+            if (token.empty()) {
+                continue;
+            }
+            NodeId to = names.Intern(std::string_view(token.begin(), token.end()));
+            edges.emplace_back(from, to);
+            reverseEdges.emplace_back(to, from);
+        }
+    }
+
+    int numNodes = names.Size();
+    return DeviceGraph{names, CsrGraph(numNodes, edges), CsrGraph(numNodes, reverseEdges)};
 }
 
-long long DFS(const Graph& reverseGraph, const Node& node, Cache& cache, const Node& fromNode) {
-    if (node == fromNode) {
-        return 1;
+// A query for the number of paths from source to target that pass through every waypoint,
+// in any order
+struct PathQuery {
+    std::string_view source;
+    std::string_view target;
+    std::vector<std::string_view> waypoints;
+};
+
+// Path counts can be large, so accumulation is always checked rather than silently wrapping
+template<class Count>
+Count CheckedAdd(Count a, Count b) {
+    Count sum;
+    if (__builtin_add_overflow(a, b, &sum)) {
+        throw std::overflow_error("Path count overflows its counter type");
     }
+    return sum;
+}
 
-    if (cache.find(node) != cache.end()) {
-        return cache[node];
+template<class Count>
+Count CheckedMul(Count a, Count b) {
+    Count product;
+    if (__builtin_mul_overflow(a, b, &product)) {
+        throw std::overflow_error("Path count overflows its counter type");
     }
+    return product;
+}
 
-    if (reverseGraph.find(node) == reverseGraph.end()) {
-        return 0;
+using WideCount = unsigned __int128;
+
+std::string ToString(WideCount value) {
+    std::string digits;
+    do {
+        digits.push_back(static_cast<char>('0' + value % 10));
+        value /= 10;
+    } while (value != 0);
+    return std::string(digits.rbegin(), digits.rend());
+}
+
+// Nodes grouped by their longest distance from a node without predecessors. Every predecessor of
+// a node lies on an earlier level, so all nodes within a level can be processed independently.
+// Level i consists of nodes[offsets[i]] up to (but not including) nodes[offsets[i + 1]].
+struct TopologicalLevels {
+    std::vector<int> offsets;
+    std::vector<NodeId> nodes;
+    std::vector<int> levelOf;
+
+    explicit TopologicalLevels(const CsrGraph& graph)
+        : offsets{0}
+        , levelOf(graph.NumNodes())
+    {
+        std::vector<int> inDegree(graph.NumNodes(), 0);
+        for (NodeId to : graph.targets) {
+            inDegree[to]++;
+        }
+        for (NodeId node = 0; node < graph.NumNodes(); ++node) {
+            if (inDegree[node] == 0) {
+                nodes.push_back(node);
+            }
+        }
+
+        // Kahn's algorithm, one level at a time
+        for (int begin = 0; begin < std::ssize(nodes); ) {
+            int end = std::ssize(nodes);
+            offsets.push_back(end);
+            for (int i = begin; i < end; ++i) {
+                levelOf[nodes[i]] = std::ssize(offsets) - 2;
+                for (NodeId neighborNode : graph.Neighbors(nodes[i])) {
+                    if (--inDegree[neighborNode] == 0) {
+                        nodes.push_back(neighborNode);
+                    }
+                }
+            }
+            begin = end;
+        }
+
+        if (std::ssize(nodes) != graph.NumNodes()) {
+            throw std::runtime_error("Device graph contains a cycle");
+        }
+    }
+
+    int NumLevels() const {
+        return std::ssize(offsets) - 1;
+    }
+};
+
+// Answers batches of path-count queries over a DAG. The nodes of the topological levels form a
+// topological order, which is computed once and shared with part A. A batch is answered with a
+// single sweep along it that propagates one path count per distinct source, instead of one
+// traversal per (source, target) pair.
+class PathCounter {
+public:
+    PathCounter(const DeviceGraph& graph, const TopologicalLevels& levels)
+        : m_graph(graph)
+        , m_order(levels.nodes)
+        , m_position(graph.forward.NumNodes())
+    {
+        for (int i = 0; i < std::ssize(m_order); ++i) {
+            m_position[m_order[i]] = i;
+        }
     }
 
-    long long totalCount = 0;
-    for (const Node& neighborNode : reverseGraph.at(node)) {
-        totalCount += DFS(reverseGraph, neighborNode, cache, fromNode);
+    std::vector<WideCount> Answer(const std::vector<PathQuery>& queries) const {
+        // Waypoint queries are sums over waypoint orders of products of the counts along each leg,
+        // so first collect all the legs that are needed
+        std::vector<std::vector<std::vector<std::pair<NodeId, NodeId>>>> chains(queries.size());
+        std::vector<NodeId> sources;
+        for (size_t queryIdx = 0; queryIdx < queries.size(); ++queryIdx) {
+            const PathQuery& query = queries[queryIdx];
+            auto source = m_graph.names.Find(query.source);
+            auto target = m_graph.names.Find(query.target);
+            std::vector<NodeId> waypoints;
+            bool allPresent = source && target;
+            for (std::string_view waypoint : query.waypoints) {
+                auto node = m_graph.names.Find(waypoint);
+                allPresent = allPresent && node;
+                waypoints.push_back(node.value_or(-1));
+            }
+            if (!allPresent) {
+                continue; // A device that doesn't appear in the input is not reachable
+            }
+
+            std::sort(waypoints.begin(), waypoints.end());
+            do {
+                auto& legs = chains[queryIdx].emplace_back();
+                NodeId from = *source;
+                for (NodeId waypoint : waypoints) {
+                    legs.emplace_back(from, waypoint);
+                    from = waypoint;
+                }
+                legs.emplace_back(from, *target);
+                for (const auto& [legFrom, legTo] : legs) {
+                    sources.push_back(legFrom);
+                }
+            } while (std::next_permutation(waypoints.begin(), waypoints.end()));
+        }
+
+        std::sort(sources.begin(), sources.end());
+        sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+        auto counts = Sweep(sources);
+
+        const int numSources = std::ssize(sources);
+        auto countLeg = [&](NodeId from, NodeId to) {
+            int sourceIdx = std::lower_bound(sources.begin(), sources.end(), from) - sources.begin();
+            return counts[static_cast<size_t>(to) * numSources + sourceIdx];
+        };
+
+        std::vector<WideCount> answers(queries.size(), 0);
+        for (size_t queryIdx = 0; queryIdx < queries.size(); ++queryIdx) {
+            for (const auto& legs : chains[queryIdx]) {
+                WideCount product = 1;
+                for (const auto& [legFrom, legTo] : legs) {
+                    product = CheckedMul(product, countLeg(legFrom, legTo));
+                }
+                answers[queryIdx] = CheckedAdd(answers[queryIdx], product);
+            }
+        }
+        return answers;
     }
-    cache[node] = totalCount;
-    return totalCount;
+
+private:
+    // Returns, for every node and source, the number of paths from that source to the node,
+    // laid out as counts[node * #sources + sourceIdx]
+    std::vector<WideCount> Sweep(const std::vector<NodeId>& sources) const {
+        const int numSources = std::ssize(sources);
+        std::vector<WideCount> counts(static_cast<size_t>(m_graph.forward.NumNodes()) * numSources, 0);
+        if (sources.empty()) {
+            return counts;
+        }
+
+        int firstPosition = std::ssize(m_order);
+        for (int sourceIdx = 0; sourceIdx < numSources; ++sourceIdx) {
+            counts[static_cast<size_t>(sources[sourceIdx]) * numSources + sourceIdx] = 1;
+            firstPosition = std::min(firstPosition, m_position[sources[sourceIdx]]);
+        }
+
+        // Nothing before the earliest source can be reached from any source
+        for (int i = firstPosition; i < std::ssize(m_order); ++i) {
+            NodeId node = m_order[i];
+            const WideCount* nodeCounts = counts.data() + static_cast<size_t>(node) * numSources;
+            for (NodeId neighborNode : m_graph.forward.Neighbors(node)) {
+                WideCount* neighborCounts = counts.data() + static_cast<size_t>(neighborNode) * numSources;
+                for (int sourceIdx = 0; sourceIdx < numSources; ++sourceIdx) {
+                    neighborCounts[sourceIdx] = CheckedAdd(neighborCounts[sourceIdx], nodeCounts[sourceIdx]);
+                }
+            }
+        }
+        return counts;
+    }
+
+    const DeviceGraph& m_graph;
+    const std::vector<NodeId>& m_order;
+    std::vector<int> m_position; // Index of each node in m_order
+};
+
+// Counts the paths from source to every node, level by level. Within a level each node pulls the
+// sum of its predecessors' counts, which are all final, so the nodes of a level are split across
+// threads without any locking and the threads only meet at a barrier between levels.
+template<class Count>
+std::vector<Count> CountPathsByLevel(const DeviceGraph& graph, const TopologicalLevels& levels, NodeId source, int numThreads) {
+    std::vector<Count> counts(graph.reverse.NumNodes(), 0);
+    counts[source] = 1;
+
+    // Nothing on the source's level or before it is reachable from the source
+    const int firstLevel = levels.levelOf[source] + 1;
+
+    std::atomic<bool> failed = false;
+    std::exception_ptr error;
+    std::barrier sync(numThreads);
+    auto work = [&](int threadIdx) {
+        Util::TraceSpan span("CountPathsByLevel");
+        for (int level = firstLevel; level < levels.NumLevels(); ++level) {
+            const int begin = levels.offsets[level];
+            const int size = levels.offsets[level + 1] - begin;
+            const int chunkBegin = begin + static_cast<long long>(size) * threadIdx / numThreads;
+            const int chunkEnd = begin + static_cast<long long>(size) * (threadIdx + 1) / numThreads;
+            if (!failed.load(std::memory_order_relaxed)) {
+                try {
+                    for (int i = chunkBegin; i < chunkEnd; ++i) {
+                        NodeId node = levels.nodes[i];
+                        Count total = 0;
+                        for (NodeId predecessor : graph.reverse.Neighbors(node)) {
+                            total = CheckedAdd(total, counts[predecessor]);
+                        }
+                        counts[node] = total;
+                    }
+                } catch (...) {
+                    if (!failed.exchange(true)) {
+                        error = std::current_exception();
+                    }
+                }
+            }
+            // Keep arriving even after a failure so no other thread is left waiting
+            sync.arrive_and_wait();
+        }
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        for (int threadIdx = 1; threadIdx < numThreads; ++threadIdx) {
+            workers.emplace_back(work, threadIdx);
+        }
+        work(0);
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return counts;
 }
 
-long long CountPaths(const Graph& reverseGraph, const Node& fromNode, const Node& toNode) {
-    Cache cache;
-    return DFS(reverseGraph, toNode, cache, fromNode);
+// Small levels are not worth synchronizing over, so only use more threads on wide graphs
+int ChooseThreadCount(const TopologicalLevels& levels) {
+    static constexpr int minNodesPerThread = 4096;
+    int widestLevel = 0;
+    for (int level = 0; level < levels.NumLevels(); ++level) {
+        widestLevel = std::max(widestLevel, levels.offsets[level + 1] - levels.offsets[level]);
+    }
+    int hardwareThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    return std::clamp(widestLevel / minNodesPerThread, 1, hardwareThreads);
 }
 
-int main() {
+void Solve() {
     auto lines = Util::LoadInput(Util::Day(11));
     Util::Timer t;
 
-    Graph graph;
-    std::transform(lines.begin(), lines.end(), std::inserter(graph, graph.end()), [](const auto& line) {
-        return CreateNode(line);
-    });
+    auto graph = BuildDeviceGraph(lines);
+    TopologicalLevels levels(graph.forward);
 
-    Graph reverseGraph;
-    for (const auto& [from, tos] : graph) {
-        for (const auto& to : tos) {
-            reverseGraph[to].push_back(from);
-        }
+    t.BeginPhase("part A");
+    auto inId = graph.names.Find(inNode);
+    auto outId = graph.names.Find(outNode);
+    WideCount answerA = 0;
+    if (inId && outId) {
+        answerA = CountPathsByLevel<WideCount>(graph, levels, *inId, ChooseThreadCount(levels))[*outId];
     }
+    Util::ProvideSolution(ToString(answerA), Util::Part::A);
 
-    long long answerA = CountPaths(reverseGraph, inNode, outNode);
-    Util::ProvideSolution(answerA, Util::Part::A);
+    t.BeginPhase("part B");
+    PathCounter pathCounter(graph, levels);
+    auto answers = pathCounter.Answer({
+        {svrNode, outNode, {fftNode, dacNode}},
+    });
+    Util::ProvideSolution(ToString(answers[0]), Util::Part::B);
+}
 
-    long long answerB =
-        CountPaths(reverseGraph, svrNode, fftNode) *
-        CountPaths(reverseGraph, fftNode, dacNode) *
-        CountPaths(reverseGraph, dacNode, outNode) + 
-        CountPaths(reverseGraph, svrNode, dacNode) *
-        CountPaths(reverseGraph, dacNode, fftNode) *
-        CountPaths(reverseGraph, fftNode, outNode);
-    Util::ProvideSolution(answerB, Util::Part::B);
-}
\ No newline at end of file
+int main(int argc, char** argv) {
+    return Util::Run(Util::Day(11), argc, argv, Solve);
+}
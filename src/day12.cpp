@@ -1,28 +1,48 @@
 #include "utils.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <shared_mutex>
 #include <span>
 #include <sstream>
-#include <queue>
-#include <algorithm>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
 
 static constexpr int shapeSize = 3;
 static constexpr int numInputShapes = 6;
+static constexpr int maxVariants = 8; // Four rotations, each optionally mirrored
 
 using Shape = std::array<std::array<bool, shapeSize>, shapeSize>;
 using Requirements = std::vector<int>;
 
-Shape RotateShapeCW(const Shape& shape) {
-    Shape out;
+constexpr Shape RotateShapeCW(const Shape& shape) {
+    Shape out{};
     for (size_t row{0}; row < shapeSize; ++row) {
         for (size_t col{0}; col < shapeSize; ++col) {
-            out[row][col] = shape[col][shapeSize - 1 - row];
+            out[row][col] = shape[shapeSize - 1 - col][row];
         }
     }
     return out;
 }
 
-Shape FlipVertically(const Shape& shape) {
-    Shape out;
+constexpr Shape FlipVertically(const Shape& shape) {
+    Shape out{};
     for (size_t col{0}; col < shapeSize; ++col) {
         for (size_t row{0}; row < shapeSize; ++row) {
             out[row][col] = shape[row][shapeSize - 1 - col];
@@ -31,32 +51,70 @@ Shape FlipVertically(const Shape& shape) {
     return out;
 }
 
-std::vector<Shape> GetAllRotations(const Shape& shape) {
-    std::vector<Shape> rotations{shape};
-    Shape rotated = shape;
-    for (int i{0}; i < 3; ++i) {
-        rotated = RotateShapeCW(shape);
-        rotations.push_back(rotated);
+// Encodes a shape with the tile at (row, col) as bit row * shapeSize + col
+constexpr uint16_t EncodeShape(const Shape& shape) {
+    uint16_t mask{0};
+    for (size_t row{0}; row < shapeSize; ++row) {
+        for (size_t col{0}; col < shapeSize; ++col) {
+            if (shape[row][col]) {
+                mask |= uint16_t{1} << (row * shapeSize + col);
+            }
+        }
     }
-    return rotations;
+    return mask;
 }
 
-std::vector<Shape> GetAllVariants(const Shape& shape) {
-    std::vector<Shape> variants;
-    auto rotations = GetAllRotations(shape);
-    auto flippedRotations = GetAllRotations(FlipVertically(shape));
-
-    variants.insert(variants.begin(), rotations.begin(), rotations.end());
-    variants.insert(variants.end(), flippedRotations.begin(), flippedRotations.end());
+// The distinct images of a shape under the eight rotations and reflections of the square,
+// ordered by their encoding
+struct VariantSet {
+    std::array<Shape, maxVariants> variants{};
+    std::array<uint16_t, maxVariants> masks{};
+    int count{0};
+};
 
-    // Remove duplicates
-    std::sort(variants.begin(), variants.end());
-    auto eraseIt = std::unique(variants.begin(), variants.end());
-    variants.erase(eraseIt, variants.end());
+constexpr VariantSet GetAllVariants(const Shape& shape) {
+    std::array<Shape, maxVariants> images{};
+    Shape image = shape;
+    for (int i{0}; i < 4; ++i) {
+        images[i] = image;
+        images[i + 4] = FlipVertically(image);
+        image = RotateShapeCW(image);
+    }
+    std::sort(images.begin(), images.end(), [](const Shape& a, const Shape& b) {
+        return EncodeShape(a) < EncodeShape(b);
+    });
+
+    VariantSet set;
+    for (const Shape& candidate : images) {
+        uint16_t mask = EncodeShape(candidate);
+        if (set.count == 0 || set.masks[set.count - 1] != mask) {
+            set.variants[set.count] = candidate;
+            set.masks[set.count] = mask;
+            set.count++;
+        }
+    }
+    return set;
+}
 
-    return variants;
+constexpr Shape ShapeFromRows(std::array<std::string_view, shapeSize> rows) {
+    Shape shape{};
+    for (size_t row{0}; row < shapeSize; ++row) {
+        for (size_t col{0}; col < shapeSize; ++col) {
+            shape[row][col] = rows[row][col] == '#';
+        }
+    }
+    return shape;
 }
 
+static_assert(EncodeShape(RotateShapeCW(ShapeFromRows({"#..", "...", "..."})))
+              == EncodeShape(ShapeFromRows({"..#", "...", "..."})));
+static_assert(GetAllVariants(ShapeFromRows({"###", "###", "###"})).count == 1);
+static_assert(GetAllVariants(ShapeFromRows({".#.", "###", ".#."})).count == 1);
+static_assert(GetAllVariants(ShapeFromRows({"###", ".#.", "###"})).count == 2);
+static_assert(GetAllVariants(ShapeFromRows({"#..", "#..", "###"})).count == 4);
+static_assert(GetAllVariants(ShapeFromRows({"###", "##.", "##."})).count == 8);
+static_assert(GetAllVariants(ShapeFromRows({"###", "#..", "###"})).count == 4);
+
 Shape ParseShape(std::span<std::string> lines) {
     Shape shape;
     for (size_t row{0}; row < lines.size(); ++row) {
@@ -67,58 +125,159 @@ Shape ParseShape(std::span<std::string> lines) {
     return shape;
 }
 
+// A shape as one bit mask per row, where bit k of a row is set if column k is part of the shape.
+// firstRow/firstCol locate the shape's first tile in reading order.
+struct CompiledShape {
+    std::array<uint64_t, shapeSize> rows;
+    int firstRow, firstCol;
+};
+
+CompiledShape CompileShape(const Shape& shape) {
+    CompiledShape compiled{};
+    for (size_t row{0}; row < shapeSize; ++row) {
+        for (size_t col{0}; col < shapeSize; ++col) {
+            if (shape[row][col]) {
+                compiled.rows[row] |= uint64_t{1} << col;
+            }
+        }
+    }
+    auto firstRow = std::find_if(compiled.rows.begin(), compiled.rows.end(), [](uint64_t mask) { return mask != 0; });
+    compiled.firstRow = firstRow - compiled.rows.begin();
+    compiled.firstCol = firstRow == compiled.rows.end() ? 0 : std::countr_zero(*firstRow);
+    return compiled;
+}
+
+// A shape variant at a fixed position in a region, with its row masks already shifted into the two
+// words of each row that it touches
+struct Placement {
+    int shapeIdx, variantIdx;
+    int row, col;
+    int word; // Index of the first word within each row
+    std::array<uint64_t, shapeSize> lo, hi;
+
+    Placement(int shapeIdx, int variantIdx, const CompiledShape& variant, int row, int col)
+        : shapeIdx(shapeIdx)
+        , variantIdx(variantIdx)
+        , row(row)
+        , col(col)
+        , word(col / 64)
+    {
+        const int shift = col % 64;
+        for (int i{0}; i < shapeSize; ++i) {
+            lo[i] = variant.rows[i] << shift;
+            hi[i] = shift == 0 ? 0 : variant.rows[i] >> (64 - shift);
+        }
+    }
+};
+
+// Region occupancy packed into 64-bit words. Cell (row, col) is bit col % 64 of word col / 64 of its
+// row. Each row carries one spare word at the end so reads and writes that straddle a word boundary
+// never need bounds checks.
 struct Region {
-    std::vector<std::vector<bool>> grid;
+    int rows, cols;
+    int wordsPerRow;
+    std::vector<uint64_t> bits;
+
+    Region(int rows, int cols)
+        : rows(rows)
+        , cols(cols)
+        , wordsPerRow((cols + 63) / 64 + 1)
+        , bits(static_cast<size_t>(rows) * wordsPerRow, 0)
+    {}
 
-    Region(int rows, int cols) : grid(rows, std::vector<bool>(cols, false)) {}
+    // Returns the occupancy of a row starting at column col, with col in the lowest bit
+    uint64_t ExtractBits(int row, int col) const {
+        const uint64_t* words = &bits[static_cast<size_t>(row) * wordsPerRow + col / 64];
+        const int shift = col % 64;
+        return shift == 0 ? words[0] : (words[0] >> shift) | (words[1] << (64 - shift));
+    }
 
-    bool CanFitShape(const Shape& shape, int row, int col) const {
-        for (size_t rowOffset{0}; rowOffset < shapeSize; ++rowOffset) {
-            for (size_t colOffset{0}; colOffset < shapeSize; ++colOffset) {
-                if (shape[rowOffset][colOffset] && grid[row + rowOffset][col + colOffset]) {
-                    return false;
-                }
-            }
+    void SetBits(int row, int col, uint64_t mask) {
+        uint64_t* words = &bits[static_cast<size_t>(row) * wordsPerRow + col / 64];
+        const int shift = col % 64;
+        words[0] |= mask << shift;
+        if (shift != 0) {
+            words[1] |= mask >> (64 - shift);
         }
-        return true;
     }
 
-    int CalculateInsertionScore(const Shape& shape, int row, int col) const {
-        int rows = std::ssize(grid);
-        int cols = std::ssize(grid[0]);
-        int score{0};
-        std::array<int, 4> drs{1, 0, -1, 0};
-        std::array<int, 4> dcs{0, 1, 0, -1};
-        for (size_t rowOffset{0}; rowOffset < shapeSize; ++rowOffset) {
-            for (size_t colOffset{0}; colOffset < shapeSize; ++colOffset) {
-                if (!shape[rowOffset][colOffset]) {
-                    continue;
-                }
+    void ClearBits(int row, int col, uint64_t mask) {
+        uint64_t* words = &bits[static_cast<size_t>(row) * wordsPerRow + col / 64];
+        const int shift = col % 64;
+        words[0] &= ~(mask << shift);
+        if (shift != 0) {
+            words[1] &= ~(mask >> (64 - shift));
+        }
+    }
 
-                // For each surrounding tile, if it is a border or an already set tile,
-                // add a point
-                for (size_t i{0}; i < 4; ++i) {
-                    int newRow = row + rowOffset + drs[i];
-                    int newCol = col + colOffset + dcs[i];
-                    if (newRow < 0 || newCol < 0 || newRow >= rows || newCol >= cols) {
-                        ++score;
-                    }else if (grid[newRow][newCol]) {
-                        ++score;
-                    }
+    // Returns the first empty cell in reading order, starting at the given row, as (row, col)
+    std::optional<std::pair<int, int>> FindFirstEmpty(int fromRow) const {
+        for (int row{fromRow}; row < rows; ++row) {
+            for (int word{0}; word * 64 < cols; ++word) {
+                uint64_t empty = ~bits[static_cast<size_t>(row) * wordsPerRow + word];
+                if (cols - word * 64 < 64) {
+                    empty &= (uint64_t{1} << (cols - word * 64)) - 1;
+                }
+                if (empty != 0) {
+                    return std::make_pair(row, word * 64 + std::countr_zero(empty));
                 }
             }
         }
-        return score;
+        return std::nullopt;
     }
 
-    void InsertShape(const Shape& shape, int row, int col) {
-        for (size_t rowOffset{0}; rowOffset < shapeSize; ++rowOffset) {
-            for (size_t colOffset{0}; colOffset < shapeSize; ++colOffset) {
-                if (shape[rowOffset][colOffset]) {
-                    grid[row + rowOffset][col + colOffset] = true;
-                }
+    bool CanFit(const Placement& placement) const {
+        const uint64_t* words = &bits[static_cast<size_t>(placement.row) * wordsPerRow + placement.word];
+        uint64_t overlap{0};
+        for (int i{0}; i < shapeSize; ++i, words += wordsPerRow) {
+            overlap |= (words[0] & placement.lo[i]) | (words[1] & placement.hi[i]);
+        }
+        return overlap == 0;
+    }
+
+    void Insert(const Placement& placement) {
+        uint64_t* words = &bits[static_cast<size_t>(placement.row) * wordsPerRow + placement.word];
+        for (int i{0}; i < shapeSize; ++i, words += wordsPerRow) {
+            words[0] |= placement.lo[i];
+            words[1] |= placement.hi[i];
+        }
+    }
+
+    void Remove(const Placement& placement) {
+        uint64_t* words = &bits[static_cast<size_t>(placement.row) * wordsPerRow + placement.word];
+        for (int i{0}; i < shapeSize; ++i, words += wordsPerRow) {
+            words[0] &= ~placement.lo[i];
+            words[1] &= ~placement.hi[i];
+        }
+    }
+
+    // Counts the sides of the shape's tiles that would touch the border or an already set tile
+    int CalculateInsertionScore(const CompiledShape& shape, int row, int col) const {
+        // Occupancy of the 5x5 window around the shape, where anything outside the region is set.
+        // Bit k of a window row is column col - 1 + k.
+        static constexpr uint64_t windowMask = (uint64_t{1} << (shapeSize + 2)) - 1;
+        std::array<uint64_t, shapeSize + 2> window;
+        const int colsInside = cols - col + 1; // Window columns that lie inside the region
+        const uint64_t outsideRight = colsInside >= shapeSize + 2 ? 0 : windowMask & ~((uint64_t{1} << colsInside) - 1);
+        for (int i{0}; i < shapeSize + 2; ++i) {
+            const int windowRow = row - 1 + i;
+            if (windowRow < 0 || windowRow >= rows) {
+                window[i] = windowMask;
+                continue;
             }
+            uint64_t bitsHere = col == 0 ? (ExtractBits(windowRow, 0) << 1) | 1 : ExtractBits(windowRow, col - 1);
+            window[i] = (bitsHere | outsideRight) & windowMask;
         }
+
+        int score{0};
+        for (int i{0}; i < shapeSize; ++i) {
+            const uint64_t shapeRow = shape.rows[i];
+            score += std::popcount(shapeRow & (window[i] >> 1));     // Above
+            score += std::popcount(shapeRow & (window[i + 2] >> 1)); // Below
+            score += std::popcount(shapeRow & window[i + 1]);        // Left
+            score += std::popcount(shapeRow & (window[i + 1] >> 2)); // Right
+        }
+        return score;
     }
 };
 
@@ -126,6 +285,12 @@ struct Puzzle {
     int rows, cols;
     Requirements requirements;
 
+    Puzzle(int rows, int cols, Requirements requirements)
+        : rows(rows)
+        , cols(cols)
+        , requirements(std::move(requirements))
+    {}
+
     Puzzle(std::string line) {
         auto x = line.find('x');
         auto colon = line.find(':');
@@ -140,22 +305,6 @@ struct Puzzle {
     }
 };
 
-struct QueueElement {
-    int score; // Used for priority. The higher the better.
-    Region region;
-    Requirements requirementsLeft;
-
-    QueueElement(const Puzzle& puzzle)
-        : score(0)
-        , region(puzzle.rows, puzzle.cols)
-        , requirementsLeft(puzzle.requirements)
-    {}
-
-    bool operator<(const QueueElement& rhs) const {
-        return score < rhs.score;
-    }
-};
-
 std::vector<Puzzle> LoadPuzzles(std::vector<std::string> input) {
     std::vector<Puzzle> puzzles;
     for (size_t shapeLine{numInputShapes * 5}; shapeLine < input.size(); ++shapeLine) {
@@ -187,6 +336,119 @@ int CountTilesInShape(const Shape& shape) {
     return count;
 }
 
+// All variants of the input shapes, compiled once and shared by every puzzle
+struct ShapeSet {
+    std::vector<std::vector<CompiledShape>> variants;
+    std::vector<int> tiles;
+
+    explicit ShapeSet(const std::vector<Shape>& shapes) {
+        for (const Shape& shape : shapes) {
+            auto shapeVariants = GetAllVariants(shape);
+            auto& compiled = variants.emplace_back();
+            std::transform(shapeVariants.variants.begin(), shapeVariants.variants.begin() + shapeVariants.count,
+                           std::back_inserter(compiled), CompileShape);
+            tiles.push_back(CountTilesInShape(shape));
+        }
+    }
+};
+
+// Every legal position of every shape variant in a region of a given size, plus a per-cell index of
+// the placements whose first tile is on the cell.
+// Cell (row, col) of the region has index row * cols + col, and the list for cell i is
+// placementIds[offsets[i]] up to (but not including) placementIds[offsets[i + 1]].
+struct PlacementTable {
+    struct CellIndex {
+        std::vector<int> offsets;
+        std::vector<int> placementIds;
+
+        std::span<const int> At(int cell) const {
+            return std::span<const int>(placementIds.data() + offsets[cell], placementIds.data() + offsets[cell + 1]);
+        }
+    };
+
+    int rows, cols;
+    std::vector<Placement> placements;
+    CellIndex anchored;
+
+    PlacementTable(const ShapeSet& shapeSet, int rows, int cols)
+        : rows(rows)
+        , cols(cols)
+    {
+        std::vector<std::pair<int, int>> anchoredPairs; // (cell, placement id)
+        for (int shapeIdx{0}; shapeIdx < std::ssize(shapeSet.variants); ++shapeIdx) {
+            const auto& variants = shapeSet.variants[shapeIdx];
+            for (int variantIdx{0}; variantIdx < std::ssize(variants); ++variantIdx) {
+                const CompiledShape& variant = variants[variantIdx];
+                for (int row{0}; row + shapeSize <= rows; ++row) {
+                    for (int col{0}; col + shapeSize <= cols; ++col) {
+                        const int id = std::ssize(placements);
+                        placements.emplace_back(shapeIdx, variantIdx, variant, row, col);
+                        anchoredPairs.emplace_back((row + variant.firstRow) * cols + col + variant.firstCol, id);
+                    }
+                }
+            }
+        }
+        anchored = BuildCellIndex(anchoredPairs, rows * cols);
+    }
+
+private:
+    static CellIndex BuildCellIndex(std::vector<std::pair<int, int>>& pairs, int numCells) {
+        // Stable, so each cell's list stays in placement order, i.e. grouped by shape
+        std::stable_sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+        CellIndex index;
+        index.offsets.assign(numCells + 1, 0);
+        for (const auto& [cell, id] : pairs) {
+            index.offsets[cell + 1]++;
+            index.placementIds.push_back(id);
+        }
+        std::partial_sum(index.offsets.begin(), index.offsets.end(), index.offsets.begin());
+        return index;
+    }
+};
+
+// Placement tables by region size. A table is built on first request and then shared read-only by
+// every puzzle and thread asking for the same size. Concurrent requests for a table that is still
+// being built wait for it rather than building it again.
+class PlacementCache {
+public:
+    explicit PlacementCache(const ShapeSet& shapeSet)
+        : m_shapeSet(shapeSet)
+    {}
+
+    std::shared_ptr<const PlacementTable> Get(int rows, int cols) {
+        std::promise<std::shared_ptr<const PlacementTable>> promise;
+        std::shared_future<std::shared_ptr<const PlacementTable>> table;
+        {
+            std::lock_guard lock(m_mutex);
+            auto [it, inserted] = m_tables.try_emplace({rows, cols});
+            if (!inserted) {
+                table = it->second;
+            }else {
+                it->second = promise.get_future().share();
+            }
+        }
+        if (table.valid()) {
+            return table.get();
+        }
+
+        try {
+            auto built = std::make_shared<const PlacementTable>(m_shapeSet, rows, cols);
+            promise.set_value(built);
+            return built;
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+private:
+    const ShapeSet& m_shapeSet;
+    std::mutex m_mutex;
+    std::map<std::pair<int, int>, std::shared_future<std::shared_ptr<const PlacementTable>>> m_tables;
+};
+
 int CountRequiredTotalTiles(const std::vector<Shape>& shapes, const Puzzle& puzzle) {
     int totalTiles{0};
     for (int shapeIdx{0}; shapeIdx < numInputShapes; ++shapeIdx) {
@@ -196,80 +458,503 @@ int CountRequiredTotalTiles(const std::vector<Shape>& shapes, const Puzzle& puzz
     return totalTiles;
 }
 
-bool IsPuzzleSolvable(const std::vector<Shape>& shapes, const Puzzle& puzzle) {
-    int requiredTiles = CountRequiredTotalTiles(shapes, puzzle);
-    if (requiredTiles > puzzle.rows * puzzle.cols) {
-        return false; // Impossible
-    }
+enum class Outcome { Solvable, Unsolvable, Unknown };
 
-    std::vector<std::vector<Shape>> shapeVariants;
-    for (int shapeIdx{0}; shapeIdx < numInputShapes; ++shapeIdx) {
-        shapeVariants.push_back(GetAllVariants(shapes[shapeIdx]));
+std::string_view OutcomeName(Outcome outcome) {
+    switch (outcome) {
+    case Outcome::Solvable: return "solvable";
+    case Outcome::Unsolvable: return "unsolvable";
+    default: return "unknown";
     }
+}
+
+// Bounds on a single search. When one is hit the search gives up and reports Outcome::Unknown.
+struct SearchLimits {
+    long long maxNodes{0}; // 0 means unlimited
+    std::chrono::steady_clock::time_point deadline{std::chrono::steady_clock::time_point::max()};
+    std::stop_token stopToken;
+};
 
-    Region emptyRegion{puzzle.rows, puzzle.cols};
-    std::priority_queue<QueueElement> pq;
-    pq.push(QueueElement(puzzle));
-    while (!pq.empty()) {
-        auto qElem = pq.top();
-        pq.pop();
+struct SolveResult {
+    Outcome outcome;
+    long long nodes;
+};
 
-        bool requirementsMet = true;
+// Exact depth-first search for a packing, working on a single region that is modified in place and
+// restored on backtrack, so memory is proportional to the search depth. Every step branches on the
+// first empty cell in reading order: either one of the remaining shapes covers it, or it is left empty
+// for good. All cells before it are decided, so a variant can only cover it with its own first tile,
+// giving at most one position per variant. Remaining shapes are tracked as counts rather than as
+// individual copies, so identical copies are only ever placed in one order.
+// Each step only looks at the placements anchored on that cell and scores them in a 5x5 window, so its
+// cost doesn't depend on the region size. Keeping a live set of every legal placement was measured to
+// be far slower: one occupied cell blocks hundreds of placements that each have to be updated and undone.
+class PlacementSolver {
+public:
+    PlacementSolver(const ShapeSet& shapeSet, const PlacementTable& table, const Puzzle& puzzle, const SearchLimits& limits)
+        : m_limits(limits)
+        , m_shapeSet(shapeSet)
+        , m_table(table)
+        , m_region(puzzle.rows, puzzle.cols)
+        , m_requirementsLeft(puzzle.requirements)
+        , m_freeCells(puzzle.rows * puzzle.cols)
+    {
         for (int shapeIdx{0}; shapeIdx < numInputShapes; ++shapeIdx) {
-            if (qElem.requirementsLeft[shapeIdx] == 0) {
-                continue; // We are not required to insert more of this shape
+            m_requiredTiles += m_requirementsLeft[shapeIdx] * m_shapeSet.tiles[shapeIdx];
+        }
+    }
+
+    SolveResult Solve() {
+        bool solved = Search(0);
+        Outcome outcome = solved ? Outcome::Solvable : m_aborted ? Outcome::Unknown : Outcome::Unsolvable;
+        return SolveResult{outcome, m_nodes};
+    }
+
+private:
+    struct Candidate {
+        int placementId;
+        int shapeIdx;
+        int score;
+    };
+
+    static constexpr long long nodesPerLimitCheck = 1024;
+
+    bool LimitReached() {
+        if (m_limits.maxNodes != 0 && m_nodes > m_limits.maxNodes) {
+            return true;
+        }
+        // The clock and the stop token are comparatively expensive, so only poll them periodically
+        return m_nodes % nodesPerLimitCheck == 0
+            && (m_limits.stopToken.stop_requested() || std::chrono::steady_clock::now() > m_limits.deadline);
+    }
+
+    bool Search(int fromRow) {
+        if (m_aborted) {
+            return false;
+        }
+        ++m_nodes;
+        if (LimitReached()) {
+            m_aborted = true;
+            return false;
+        }
+        if (m_requiredTiles == 0) {
+            return true;
+        }
+        if (m_freeCells < m_requiredTiles) {
+            return false; // Not enough room left for the remaining shapes
+        }
+
+        auto firstEmpty = m_region.FindFirstEmpty(fromRow);
+        if (!firstEmpty) {
+            return false;
+        }
+        const auto [row, col] = *firstEmpty;
+
+        // Collect every placement that covers the cell with the first tile of a variant
+        std::array<Candidate, numInputShapes * maxVariants> candidates;
+        std::array<int, numInputShapes> fitCounts{};
+        int numCandidates{0};
+        for (int placementId : m_table.anchored.At(row * m_table.cols + col)) {
+            const Placement& placement = m_table.placements[placementId];
+            if (m_requirementsLeft[placement.shapeIdx] == 0 || !m_region.CanFit(placement)) {
+                continue;
             }
-            requirementsMet = false;
-
-            bool couldFitAnyShape = false;
-            for (const Shape& shapeVariant : shapeVariants[shapeIdx]) {
-                for (size_t row{0}; row < puzzle.rows - shapeSize + 1; ++row) {
-                    for (size_t col{0}; col < puzzle.cols - shapeSize + 1; ++col) {
-                        if (!qElem.region.CanFitShape(shapeVariant, row, col)) {
-                            continue;
-                        }
-
-                        // Shape variant fits here. Compute the score of inserting it
-                        auto fitScore = qElem.region.CalculateInsertionScore(shapeVariant, row, col);
-                        if (fitScore < 3) {
-                            continue;
-                        }
-
-                        auto newElement = qElem;
-                        newElement.score += fitScore;
-                        newElement.requirementsLeft[shapeIdx]--;
-                        newElement.region.InsertShape(shapeVariant, row, col);
-                        pq.push(newElement);
-                        
-                        couldFitAnyShape = true;
+            const CompiledShape& variant = m_shapeSet.variants[placement.shapeIdx][placement.variantIdx];
+            int score = m_region.CalculateInsertionScore(variant, placement.row, placement.col);
+            candidates[numCandidates++] = Candidate{placementId, placement.shapeIdx, score};
+            fitCounts[placement.shapeIdx]++;
+        }
+
+        // Try the most constrained shapes first, and the snuggest placements within a shape
+        const auto mostConstrainedFirst = [&fitCounts](const Candidate& a, const Candidate& b) {
+            if (fitCounts[a.shapeIdx] != fitCounts[b.shapeIdx]) return fitCounts[a.shapeIdx] < fitCounts[b.shapeIdx];
+            if (a.shapeIdx != b.shapeIdx) return a.shapeIdx < b.shapeIdx;
+            return a.score > b.score;
+        };
+        std::sort(candidates.begin(), candidates.begin() + numCandidates, mostConstrainedFirst);
+
+        for (int i{0}; i < numCandidates; ++i) {
+            const Candidate& candidate = candidates[i];
+            const Placement& placement = m_table.placements[candidate.placementId];
+            const int tiles = m_shapeSet.tiles[candidate.shapeIdx];
+
+            m_region.Insert(placement);
+            m_requirementsLeft[candidate.shapeIdx]--;
+            m_requiredTiles -= tiles;
+            m_freeCells -= tiles;
+
+            bool solved = Search(row);
+
+            m_region.Remove(placement);
+            m_requirementsLeft[candidate.shapeIdx]++;
+            m_requiredTiles += tiles;
+            m_freeCells += tiles;
+
+            if (solved || m_aborted) {
+                return solved;
+            }
+        }
+
+        // Leave the cell empty, which is only possible if there is slack to spare
+        if (m_freeCells - 1 < m_requiredTiles) {
+            return false;
+        }
+        m_region.SetBits(row, col, 1);
+        m_freeCells--;
+        bool solved = Search(row);
+        m_region.ClearBits(row, col, 1);
+        m_freeCells++;
+        return solved;
+    }
+
+    const SearchLimits& m_limits;
+    const ShapeSet& m_shapeSet;
+    const PlacementTable& m_table;
+    Region m_region;
+    Requirements m_requirementsLeft;
+    int m_requiredTiles{0};
+    int m_freeCells;
+    long long m_nodes{0};
+    bool m_aborted{false};
+};
+
+// Decides most puzzles without searching, using bounds from cheapest to most expensive:
+//  1. More tiles than cells can never fit.
+//  2. Every shape fits in a 3x3 box, so if there is a disjoint 3x3 slot for each shape it always fits.
+//  3. Two shapes often fit together in a box narrower than 3x6. The region is cut into bands of three
+//     rows (or columns), shapes are paired up into such boxes, and the boxes are packed into the
+//     bands. If they all fit, so do the shapes.
+// Everything else is close enough to the boundary that it has to be searched.
+class SolvabilityClassifier {
+public:
+    SolvabilityClassifier(const ShapeSet& shapeSet, PlacementCache& placementCache)
+        : m_shapeSet(shapeSet)
+    {
+        // Precompute the narrowest box each pair of shapes fits in, in both orientations
+        for (int shapeA{0}; shapeA < numInputShapes; ++shapeA) {
+            for (int shapeB{shapeA}; shapeB < numInputShapes; ++shapeB) {
+                Requirements requirements(numInputShapes, 0);
+                requirements[shapeA]++;
+                requirements[shapeB]++;
+                for (int length{shapeSize + 1}; length < 2 * shapeSize; ++length) {
+                    if (m_pairLengths[0][shapeA][shapeB] == 0
+                        && Fits(placementCache, Puzzle(shapeSize, length, requirements))) {
+                        m_pairLengths[0][shapeA][shapeB] = m_pairLengths[0][shapeB][shapeA] = length;
+                    }
+                    if (m_pairLengths[1][shapeA][shapeB] == 0
+                        && Fits(placementCache, Puzzle(length, shapeSize, requirements))) {
+                        m_pairLengths[1][shapeA][shapeB] = m_pairLengths[1][shapeB][shapeA] = length;
                     }
                 }
             }
+        }
+    }
+
+    std::optional<Outcome> Classify(const Puzzle& puzzle) const {
+        int requiredTiles{0};
+        int requiredShapes{0};
+        for (int shapeIdx{0}; shapeIdx < numInputShapes; ++shapeIdx) {
+            requiredTiles += puzzle.requirements[shapeIdx] * m_shapeSet.tiles[shapeIdx];
+            requiredShapes += puzzle.requirements[shapeIdx];
+        }
+        if (requiredTiles > puzzle.rows * puzzle.cols) {
+            return Outcome::Unsolvable;
+        }
+        if ((puzzle.rows / shapeSize) * (puzzle.cols / shapeSize) >= requiredShapes) {
+            return Outcome::Solvable;
+        }
+        if (FitsInBands(puzzle.requirements, puzzle.rows / shapeSize, puzzle.cols, 0)
+            || FitsInBands(puzzle.requirements, puzzle.cols / shapeSize, puzzle.rows, 1)) {
+            return Outcome::Solvable;
+        }
+        return std::nullopt;
+    }
 
-            if (!couldFitAnyShape) {
+private:
+    bool Fits(PlacementCache& placementCache, const Puzzle& puzzle) const {
+        auto table = placementCache.Get(puzzle.rows, puzzle.cols);
+        return PlacementSolver(m_shapeSet, *table, puzzle, SearchLimits{}).Solve().outcome == Outcome::Solvable;
+    }
+
+    // Checks if the shapes can be packed into numBands bands that are three cells wide and
+    // bandLength cells long, using single 3x3 boxes and the precomputed pair boxes
+    bool FitsInBands(Requirements left, int numBands, int bandLength, int orientation) const {
+        std::vector<int> boxLengths;
+
+        // Pair up shapes, starting with the pairs that save the most length
+        std::vector<std::tuple<int, int, int>> pairs;
+        for (int shapeA{0}; shapeA < numInputShapes; ++shapeA) {
+            for (int shapeB{shapeA}; shapeB < numInputShapes; ++shapeB) {
+                if (int length = m_pairLengths[orientation][shapeA][shapeB]; length != 0) {
+                    pairs.emplace_back(length, shapeA, shapeB);
+                }
+            }
+        }
+        std::sort(pairs.begin(), pairs.end());
+        for (const auto& [length, shapeA, shapeB] : pairs) {
+            int count = shapeA == shapeB ? left[shapeA] / 2 : std::min(left[shapeA], left[shapeB]);
+            left[shapeA] -= count;
+            left[shapeB] -= count;
+            boxLengths.insert(boxLengths.end(), count, length);
+        }
+        boxLengths.insert(boxLengths.end(), std::accumulate(left.begin(), left.end(), 0), shapeSize);
+
+        // First fit decreasing
+        std::sort(boxLengths.begin(), boxLengths.end(), std::greater<>());
+        std::vector<int> spaceLeft(numBands, bandLength);
+        for (int boxLength : boxLengths) {
+            auto band = std::find_if(spaceLeft.begin(), spaceLeft.end(),
+                                     [boxLength](int space) { return space >= boxLength; });
+            if (band == spaceLeft.end()) {
                 return false;
             }
+            *band -= boxLength;
         }
+        return true;
+    }
 
-        if (requirementsMet) {
-            return true;
+    const ShapeSet& m_shapeSet;
+    // Length of the narrowest 3 x length box (orientation 0) or length x 3 box (orientation 1) that
+    // fits both shapes, or 0 if they need the full 3x6
+    std::array<std::array<std::array<int, numInputShapes>, numInputShapes>, 2> m_pairLengths{};
+};
+
+// Outcomes of earlier searches, by region size. Solvability is monotone in the requirements: if a
+// set of shapes fits, so does every subset of it, and if it doesn't fit, neither does any superset.
+// So a query is answered by any recorded solvable vector that is component-wise >= it, or any recorded
+// unsolvable vector that is <= it. Only the maximal solvable and minimal unsolvable vectors are kept,
+// ordered by their shape totals so that a lookup only visits vectors whose total could dominate.
+class DominanceCache {
+public:
+    std::optional<Outcome> Lookup(const Puzzle& puzzle) const {
+        const Entry query = MakeEntry(puzzle.requirements);
+        std::shared_lock lock(m_mutex);
+        auto it = m_frontiers.find({puzzle.rows, puzzle.cols});
+        if (it == m_frontiers.end()) {
+            return std::nullopt;
+        }
+        const Frontier& frontier = it->second;
+
+        // Solvable entries are ordered by decreasing total, unsolvable ones by increasing total
+        for (const Entry& solvable : frontier.solvable) {
+            if (solvable.total < query.total) break;
+            if (Dominates(solvable, query)) return Outcome::Solvable;
+        }
+        for (const Entry& unsolvable : frontier.unsolvable) {
+            if (unsolvable.total > query.total) break;
+            if (Dominates(query, unsolvable)) return Outcome::Unsolvable;
+        }
+        return std::nullopt;
+    }
+
+    void Record(const Puzzle& puzzle, Outcome outcome) {
+        if (outcome == Outcome::Unknown) {
+            return;
+        }
+        const Entry entry = MakeEntry(puzzle.requirements);
+        std::unique_lock lock(m_mutex);
+        Frontier& frontier = m_frontiers[{puzzle.rows, puzzle.cols}];
+        if (outcome == Outcome::Solvable) {
+            Insert(frontier.solvable, entry, [](const Entry& a, const Entry& b) { return Dominates(a, b); }, true);
+        }else {
+            Insert(frontier.unsolvable, entry, [](const Entry& a, const Entry& b) { return Dominates(b, a); }, false);
+        }
+    }
+
+private:
+    struct Entry {
+        std::array<int, numInputShapes> counts;
+        int total;
+    };
+
+    struct Frontier {
+        std::vector<Entry> solvable;
+        std::vector<Entry> unsolvable;
+    };
+
+    static Entry MakeEntry(const Requirements& requirements) {
+        Entry entry{};
+        std::copy(requirements.begin(), requirements.end(), entry.counts.begin());
+        entry.total = std::accumulate(requirements.begin(), requirements.end(), 0);
+        return entry;
+    }
+
+    // True if every count of a is at least the corresponding count of b
+    static bool Dominates(const Entry& a, const Entry& b) {
+        for (int shapeIdx{0}; shapeIdx < numInputShapes; ++shapeIdx) {
+            if (a.counts[shapeIdx] < b.counts[shapeIdx]) {
+                return false;
+            }
         }
+        return true;
     }
 
-    return false;
+    // Adds an entry to an antichain unless an existing entry covers it, dropping the entries it covers.
+    // covers(a, b) means that knowing a makes b redundant. The antichain stays ordered by total,
+    // decreasing or increasing.
+    static void Insert(std::vector<Entry>& antichain, const Entry& entry, auto covers, bool decreasingTotal) {
+        if (std::any_of(antichain.begin(), antichain.end(), [&](const Entry& existing) { return covers(existing, entry); })) {
+            return;
+        }
+        std::erase_if(antichain, [&](const Entry& existing) { return covers(entry, existing); });
+        auto position = std::find_if(antichain.begin(), antichain.end(), [&](const Entry& existing) {
+            return decreasingTotal ? existing.total < entry.total : existing.total > entry.total;
+        });
+        antichain.insert(position, entry);
+    }
+
+    mutable std::shared_mutex m_mutex;
+    std::map<std::pair<int, int>, Frontier> m_frontiers;
+};
+
+SolveResult IsPuzzleSolvable(const ShapeSet& shapeSet, const SolvabilityClassifier& classifier,
+                             PlacementCache& placementCache, DominanceCache& dominanceCache,
+                             const Puzzle& puzzle, const SearchLimits& limits) {
+    Util::TraceSpan span("IsPuzzleSolvable");
+    if (auto outcome = classifier.Classify(puzzle)) {
+        return SolveResult{*outcome, 0};
+    }
+    if (auto outcome = dominanceCache.Lookup(puzzle)) {
+        return SolveResult{*outcome, 0};
+    }
+
+    auto table = placementCache.Get(puzzle.rows, puzzle.cols);
+    PlacementSolver solver(shapeSet, *table, puzzle, limits);
+    auto result = solver.Solve();
+    dominanceCache.Record(puzzle, result.outcome);
+    return result;
 }
 
-int main() {
+struct PuzzleReport {
+    Outcome outcome;
+    long long nodes;
+    std::chrono::microseconds elapsed;
+};
+
+struct SchedulerOptions {
+    int numThreads{std::max(1, static_cast<int>(std::thread::hardware_concurrency()))};
+    long long nodeBudget{0};              // Per puzzle. 0 means unlimited
+    std::chrono::milliseconds timeBudget{0}; // Per puzzle. 0 means unlimited
+};
+
+// Solves a batch of puzzles on a pool of worker threads. Puzzles with the most area to spare are
+// handed out first since they tend to be quick, leaving the tight ones for last so they don't hold
+// up the rest. Cancel() asks all running searches to stop at their next limit check.
+class PuzzleScheduler {
+public:
+    PuzzleScheduler(const std::vector<Shape>& shapes, SchedulerOptions options)
+        : m_shapes(shapes)
+        , m_shapeSet(shapes)
+        , m_placementCache(m_shapeSet)
+        , m_classifier(m_shapeSet, m_placementCache)
+        , m_options(options)
+    {}
+
+    std::vector<PuzzleReport> Run(const std::vector<Puzzle>& puzzles) {
+        // Order by slack, where puzzles that don't even have the area are decided immediately
+        std::vector<std::pair<int, int>> slackAndIndex;
+        for (int i{0}; i < std::ssize(puzzles); ++i) {
+            int slack = puzzles[i].rows * puzzles[i].cols - CountRequiredTotalTiles(m_shapes, puzzles[i]);
+            slackAndIndex.emplace_back(slack < 0 ? std::numeric_limits<int>::max() : slack, i);
+        }
+        std::sort(slackAndIndex.begin(), slackAndIndex.end(), std::greater<>());
+
+        std::vector<PuzzleReport> reports(puzzles.size());
+        std::atomic<int> nextPuzzle{0};
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        auto work = [&]() {
+            for (int i = nextPuzzle++; i < std::ssize(puzzles); i = nextPuzzle++) {
+                const int puzzleIdx = slackAndIndex[i].second;
+                const auto start = std::chrono::steady_clock::now();
+                SearchLimits limits{m_options.nodeBudget, std::chrono::steady_clock::time_point::max(),
+                                    m_stopSource.get_token()};
+                if (m_options.timeBudget.count() != 0) {
+                    limits.deadline = start + m_options.timeBudget;
+                }
+                try {
+                    auto result = IsPuzzleSolvable(m_shapeSet, m_classifier, m_placementCache, m_dominanceCache,
+                                                   puzzles[puzzleIdx], limits);
+                    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start);
+                    reports[puzzleIdx] = PuzzleReport{result.outcome, result.nodes, elapsed};
+                } catch (...) {
+                    std::lock_guard lock(errorMutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    Cancel();
+                }
+            }
+        };
+
+        {
+            std::vector<std::jthread> workers;
+            const int numWorkers = std::clamp(static_cast<int>(puzzles.size()), 1, m_options.numThreads);
+            for (int workerIdx{1}; workerIdx < numWorkers; ++workerIdx) {
+                workers.emplace_back(work);
+            }
+            work();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return reports;
+    }
+
+    void Cancel() {
+        m_stopSource.request_stop();
+    }
+
+private:
+    const std::vector<Shape>& m_shapes;
+    ShapeSet m_shapeSet;
+    PlacementCache m_placementCache;
+    SolvabilityClassifier m_classifier;
+    DominanceCache m_dominanceCache;
+    SchedulerOptions m_options;
+    std::stop_source m_stopSource;
+};
+
+void Solve() {
     auto lines = Util::LoadInput(Util::Day(12));
     Util::Timer t;
 
     auto shapes = LoadShapes(lines);
     auto puzzles = LoadPuzzles(lines);
 
+    t.BeginPhase("part A");
+    // Searches run to completion unless a per-puzzle budget is asked for, since an undecided puzzle
+    // can't be counted either way
+    SchedulerOptions options;
+    if (const char* budget = std::getenv("AOC_TIME_BUDGET_MS")) {
+        options.timeBudget = std::chrono::milliseconds(std::stoll(budget));
+    }
+    PuzzleScheduler scheduler(shapes, options);
+    auto reports = scheduler.Run(puzzles);
+
     int solvableCount = 0;
-    for (const auto& puzzle : puzzles) {
-        auto solvable = IsPuzzleSolvable(shapes, puzzle);
-        std::cout << std::boolalpha << solvable << "\n";
+    int undecidedCount = 0;
+    for (size_t puzzleIdx{0}; puzzleIdx < reports.size(); ++puzzleIdx) {
+        const auto& [outcome, nodes, elapsed] = reports[puzzleIdx];
+        const auto& puzzle = puzzles[puzzleIdx];
+        std::println(Util::Output(), "Puzzle {} ({}x{}): {} after {} nodes in {}µs",
+                     puzzleIdx, puzzle.rows, puzzle.cols, OutcomeName(outcome), nodes, elapsed.count());
+        if (outcome == Outcome::Solvable) {
+            solvableCount++;
+        }else if (outcome == Outcome::Unknown) {
+            undecidedCount++;
+        }
     }
     Util::ProvideSolution(solvableCount, Util::Part::A);
+    if (undecidedCount > 0) {
+        std::println(Util::Output(),
+                     "Warning: {} puzzles were undecided within the time budget, so part A is only a lower bound",
+                     undecidedCount);
+    }
+}
+
+int main(int argc, char** argv) {
+    return Util::Run(Util::Day(12), argc, argv, Solve);
 }
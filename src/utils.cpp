@@ -9,24 +9,34 @@
 #include <string_view>
 #include <vector>
 #include <ranges>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <charconv>
+#include <csignal>
+#include <cerrno>
 
-namespace Util {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
 
-// --- Internal helpers. Not exposed publicly
-static std::string ReadFile(const std::filesystem::path& path) {
-    std::ifstream file(path, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error("Cannot open file: " + path.string());
-    }
+#ifdef TRACE
+#include <atomic>
+#include <mutex>
+#endif
 
-    file.seekg(0, std::ios::end);
-    std::string contents(static_cast<size_t>(file.tellg()), '\0');
-    file.seekg(0);
-    file.read(contents.data(), contents.size());
+#ifdef ALLOC_STATS
+#include <atomic>
+#include <cstddef>
+#include <new>
+#endif
 
-    return contents;
-}
+namespace Util {
 
+// --- Internal helpers. Not exposed publicly
 static std::vector<std::string> ReadLines(const std::filesystem::path& path) {
     std::ifstream file(path);
     if (!file) {
@@ -47,15 +57,240 @@ static std::vector<std::string> ReadLines(const std::filesystem::path& path) {
     return lines;
 }
 
-// Loads input from a file with name such as "inputs/01/a.txt"
-std::vector<std::string> LoadInput(Day day) {
+// Splits text into lines the way std::getline would
+static std::vector<std::string> SplitLines(std::string_view text) {
+    std::vector<std::string> lines;
+    while (!text.empty()) {
+        const size_t end = std::min(text.find('\n'), text.size());
+        lines.emplace_back(text.substr(0, end));
+        text.remove_prefix(std::min(end + 1, text.size()));
+    }
+    return lines;
+}
+
+namespace {
+
+// Input of the request being served, which replaces the day's own input
+struct InputOverride {
+    std::optional<std::filesystem::path> path; // Nothing if the input was sent as text
+    std::optional<std::string> text;           // Nothing if the input is in a file
+};
+
+std::optional<InputOverride> inputOverride;
+FILE* output = stdout;
+
+} // namespace
+
+#ifndef EMBED_INPUT
+// Path to a file such as "inputs/01.txt". The directory can be overridden with AOC_INPUT_DIR, e.g. to
+// run on larger generated inputs
+static std::filesystem::path InputPath(Day day) {
     const std::string filename = std::format("{:02d}.txt", day.value);
-    const std::filesystem::path path = std::filesystem::path("inputs") / filename;
+    const char* inputDir = std::getenv("AOC_INPUT_DIR");
+    return std::filesystem::path(inputDir ? inputDir : "inputs") / filename;
+}
+#endif
+
+// The file the input is read from, or nothing if it is already in memory
+static std::optional<std::filesystem::path> InputFile([[maybe_unused]] Day day) {
+    if (inputOverride) {
+        return inputOverride->path;
+    }
+#ifdef EMBED_INPUT
+    return std::nullopt;
+#else
+    return InputPath(day);
+#endif
+}
+
+// --- Input cache. Layout: CacheHeader, the length of each column, then the column values, all in
+// native byte order. A cache is only used if it was written for the same input file, day and parser
+// version, so a stale or foreign cache is simply rebuilt
+namespace {
+
+constexpr char cacheMagic[8] = {'A', 'O', 'C', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t cacheLayoutVersion = 2;
+
+// Identifies an input file without reading all of it
+struct InputStamp {
+    uint64_t size;
+    int64_t modifiedTime;
+    uint64_t sampleHash; // Hash of evenly spread samples of the contents
+
+    bool operator==(const InputStamp&) const = default;
+};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t layoutVersion;
+    uint32_t parserVersion;
+    uint32_t day; // Any day can be run on any input file, but each day parses it differently
+    InputStamp stamp;
+    uint64_t numColumns;
+};
+
+InputStamp StampInput(const std::filesystem::path& path) {
+    static constexpr size_t numSamples = 16;
+    static constexpr size_t sampleSize = 4096;
+
+    InputStamp stamp{};
+    stamp.size = std::filesystem::file_size(path);
+    stamp.modifiedTime = std::filesystem::last_write_time(path).time_since_epoch().count();
+
+    // FNV-1a over the samples, which cover the whole file if it is small
+    std::ifstream file(path, std::ios::binary);
+    std::string sample(sampleSize, '\0');
+    uint64_t hash = 14695981039346656037ULL;
+    const uint64_t stride = std::max<uint64_t>(sampleSize, stamp.size / numSamples);
+    for (uint64_t offset = 0; offset < stamp.size; offset += stride) {
+        file.seekg(offset);
+        file.read(sample.data(), sampleSize);
+        for (char c : std::string_view(sample.data(), file.gcount())) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        file.clear();
+    }
+    stamp.sampleHash = hash;
+    return stamp;
+}
+
+std::optional<ParsedInput> MapCache(const std::filesystem::path& path, Day day, uint32_t parserVersion, size_t numColumns,
+                                    const InputStamp& stamp) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    struct stat info;
+    const bool statted = fstat(fd, &info) == 0;
+    const size_t size = statted ? info.st_size : 0;
+    void* data = size >= sizeof(CacheHeader) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED) {
+        return std::nullopt;
+    }
+    std::shared_ptr<const void> mapping(data, [size](const void* ptr) { munmap(const_cast<void*>(ptr), size); });
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0
+        || header.layoutVersion != cacheLayoutVersion
+        || header.parserVersion != parserVersion
+        || header.day != static_cast<uint32_t>(day.value)
+        || !(header.stamp == stamp)
+        || header.numColumns != numColumns
+        || header.numColumns > (size - sizeof(header)) / sizeof(uint64_t)) {
+        return std::nullopt;
+    }
+
+    const auto* lengths = reinterpret_cast<const uint64_t*>(static_cast<const char*>(data) + sizeof(header));
+    const auto* values = reinterpret_cast<const long long*>(lengths + header.numColumns);
+    const size_t numValues = (size - sizeof(header)) / sizeof(uint64_t) - header.numColumns;
+    std::vector<std::span<const long long>> columns;
+    size_t offset = 0;
+    for (uint64_t i = 0; i < header.numColumns; ++i) {
+        if (lengths[i] > numValues - offset) {
+            return std::nullopt; // Truncated
+        }
+        columns.emplace_back(values + offset, lengths[i]);
+        offset += lengths[i];
+    }
+    return ParsedInput(std::move(mapping), std::move(columns));
+}
+
+// Caching is best effort: failing to write the cache only means the next run parses again
+void WriteCache(const std::filesystem::path& path, Day day, uint32_t parserVersion, const InputStamp& stamp,
+                const Columns& columns) {
+    // Write to a temporary file first so a concurrent run never maps a half-written cache
+    std::filesystem::path tempPath = path;
+    tempPath += std::format(".{}.tmp", getpid());
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file) {
+            return;
+        }
+        CacheHeader header{};
+        std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+        header.layoutVersion = cacheLayoutVersion;
+        header.parserVersion = parserVersion;
+        header.day = day.value;
+        header.stamp = stamp;
+        header.numColumns = columns.size();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& column : columns) {
+            const uint64_t length = column.size();
+            file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        }
+        for (const auto& column : columns) {
+            file.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(long long));
+        }
+        if (!file) {
+            file.close();
+            std::filesystem::remove(tempPath);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+}
+
+} // namespace
+
+ParsedInput::ParsedInput(Columns columns) {
+    auto owned = std::make_shared<const Columns>(std::move(columns));
+    for (const auto& column : *owned) {
+        m_columns.emplace_back(column);
+    }
+    m_storage = std::move(owned);
+}
+
+ParsedInput::ParsedInput(std::shared_ptr<const void> mapping, std::vector<std::span<const long long>> columns)
+    : m_storage(std::move(mapping))
+    , m_columns(std::move(columns))
+{}
+
+ParsedInput LoadParsedInput(Day day, uint32_t parserVersion, size_t numColumns, const InputParser& parse) {
+    const auto textPath = InputFile(day);
+    if (!textPath) {
+        // The input is already in memory, so there is no file to cache next to
+        return ParsedInput(parse(LoadInput(day)));
+    }
+
+    const std::filesystem::path cachePath = std::filesystem::path(*textPath).replace_extension("cache");
+    const InputStamp stamp = StampInput(*textPath);
+    if (auto cached = MapCache(cachePath, day, parserVersion, numColumns, stamp)) {
+        return *cached;
+    }
+
+    Columns columns = parse(LoadInput(day));
+    WriteCache(cachePath, day, parserVersion, stamp, columns);
+    return ParsedInput(std::move(columns));
+}
+
+std::optional<std::string_view> LoadRawInput([[maybe_unused]] Day day) {
+    if (inputOverride) {
+        return inputOverride->text;
+    }
+#ifdef EMBED_INPUT
+    if (day.value != Embedded::day) {
+        throw std::runtime_error(std::format("This build embeds the input for day {}, not day {}", Embedded::day, day.value));
+    }
+    return embeddedInput;
+#else
+    return std::nullopt;
+#endif
+}
+
+// Loads input from a file with name such as "inputs/01.txt"
+std::vector<std::string> LoadInput(Day day) {
+    if (auto text = LoadRawInput(day)) {
+        return SplitLines(*text);
+    }
+    const auto path = InputFile(day);
 
     try {
-        return ReadLines(path);
+        return ReadLines(*path);
     } catch (const std::ios_base::failure& e) {
-        throw std::runtime_error(std::format("Failed to read input file '{}': {}", path.string(), e.what()));
+        throw std::runtime_error(std::format("Failed to read input file '{}': {}", path->string(), e.what()));
     }
 }
 
@@ -68,4 +303,304 @@ std::vector<std::string> SplitString(const std::string& str, char splitter) {
         | std::ranges::to<std::vector>();
 }
 
+FILE* Output() {
+    return output;
+}
+
+// --- Service mode. Requests are lines on stdin or a socket connection:
+//   path <file>     Solve the input in a file
+//   raw <n>         Solve the input given in the following n lines
+//   quit            Close the connection
+// Each response is what the day printed, an "error <message>" line if it failed, the time taken as
+// "time <micros>µs", and finally "end".
+namespace {
+
+std::optional<std::string> ReadLine(FILE* in) {
+    std::string line;
+    int c;
+    while ((c = std::fgetc(in)) != EOF && c != '\n') {
+        line += static_cast<char>(c);
+    }
+    if (c == EOF && line.empty()) {
+        return std::nullopt;
+    }
+    return line;
+}
+
+void Respond(FILE* out, const std::function<void()>& solve, InputOverride request) {
+    // Capture everything the day prints so it ends up in the response
+    char* buffer = nullptr;
+    size_t size = 0;
+    FILE* captured = open_memstream(&buffer, &size);
+    if (!captured) {
+        throw std::runtime_error("Cannot capture output");
+    }
+    output = captured;
+    inputOverride = std::move(request);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::optional<std::string> error;
+    try {
+        solve();
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    inputOverride.reset();
+    output = stdout;
+    std::fclose(captured);
+    std::fwrite(buffer, 1, size, out);
+    std::free(buffer);
+
+    if (error) {
+        std::println(out, "error {}", *error);
+    }
+    std::println(out, "time {}µs", micros);
+    std::println(out, "end");
+    std::fflush(out);
+}
+
+void ServeStream(FILE* in, FILE* out, const std::function<void()>& solve) {
+    while (auto line = ReadLine(in)) {
+        const std::string_view request = *line;
+        if (request.empty()) {
+            continue;
+        }
+        if (request == "quit") {
+            return;
+        }
+
+        if (request.starts_with("path ")) {
+            Respond(out, solve, InputOverride{std::filesystem::path(request.substr(5)), std::nullopt});
+            continue;
+        }
+        size_t numLines = 0;
+        const auto countText = request.substr(std::min<size_t>(4, request.size()));
+        if (request.starts_with("raw ") && std::from_chars(countText.data(), countText.data() + countText.size(), numLines).ec == std::errc{}) {
+            std::string text;
+            for (size_t i = 0; i < numLines; ++i) {
+                auto inputLine = ReadLine(in);
+                if (!inputLine) {
+                    return; // The connection closed halfway through the input
+                }
+                text += *inputLine;
+                text += '\n';
+            }
+            Respond(out, solve, InputOverride{std::nullopt, std::move(text)});
+            continue;
+        }
+
+        std::println(out, "error Unknown request: {}", request);
+        std::println(out, "end");
+        std::fflush(out);
+    }
+}
+
+// Connections are served one at a time. The days parallelize internally where it pays off
+void ServeSocket(const std::filesystem::path& path, const std::function<void()>& solve) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.native().size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + path.string());
+    }
+    std::strcpy(address.sun_path, path.c_str());
+
+    // Only a stale socket left by an earlier run may be replaced, never a regular file given by mistake
+    struct stat info{};
+    if (lstat(path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            throw std::runtime_error(std::format("Cannot listen on {}: it exists and is not a socket", path.string()));
+        }
+        unlink(path.c_str());
+    }
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        const int error = errno;
+        if (listener >= 0) {
+            close(listener);
+        }
+        throw std::runtime_error(std::format("Cannot listen on {}: {}", path.string(), std::strerror(error)));
+    }
+    // A client that disconnects early must not take the service down with it
+    std::signal(SIGPIPE, SIG_IGN);
+
+    while (true) {
+        const int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::format("Cannot accept connection: {}", std::strerror(errno)));
+        }
+        FILE* in = fdopen(connection, "r");
+        FILE* out = fdopen(dup(connection), "w");
+        if (in && out) {
+            ServeStream(in, out, solve);
+        }
+        if (in) std::fclose(in); else close(connection);
+        if (out) std::fclose(out);
+    }
+}
+
+} // namespace
+
+int Run(Day day, int argc, char** argv, const std::function<void()>& solve) {
+    const std::vector<std::string_view> args(argv + 1, argv + argc);
+    if (!args.empty() && args[0] == "--serve") {
+        if (args.size() > 1) {
+            std::println(stderr, "Serving day {} on {}", day.value, args[1]);
+            ServeSocket(args[1], solve);
+        }else {
+            ServeStream(stdin, stdout, solve);
+        }
+        return 0;
+    }
+
+    if (args.size() == 1) {
+        inputOverride = InputOverride{std::filesystem::path(args[0]), std::nullopt};
+    }else if (!args.empty()) {
+        std::println(stderr, "Usage: {} [input file | --serve [socket path]]", argv[0]);
+        return 1;
+    }
+    solve();
+    return 0;
+}
+
+#ifdef ALLOC_STATS
+// --- Allocation accounting. Every block gets a header holding its size, so frees can be counted too
+namespace {
+
+constexpr size_t headerSize = alignof(std::max_align_t);
+
+std::atomic<size_t> allocationCount{0};
+std::atomic<size_t> allocatedBytes{0};
+std::atomic<size_t> liveBytes{0};
+std::atomic<size_t> peakBytes{0};
+
+void* CountedAlloc(size_t size) {
+    void* block = std::malloc(size + headerSize);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(block) = size;
+
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    const size_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+    return static_cast<char*>(block) + headerSize;
+}
+
+void CountedFree(void* ptr) noexcept {
+    if (!ptr) {
+        return;
+    }
+    void* block = static_cast<char*>(ptr) - headerSize;
+    liveBytes.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+} // namespace
+
+AllocationStats TakeAllocationStats() {
+    return AllocationStats{
+        allocationCount.exchange(0, std::memory_order_relaxed),
+        allocatedBytes.exchange(0, std::memory_order_relaxed),
+        peakBytes.exchange(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed),
+    };
+}
+#endif
+
+#ifdef TRACE
+// --- Trace events. Spans are collected in memory and written when the program exits
+namespace {
+
+struct TraceEvent {
+    std::string name;
+    double startMicros;
+    double durationMicros;
+    int threadId;
+};
+
+class TraceLog {
+public:
+    void Add(std::string_view name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+        using Micros = std::chrono::duration<double, std::micro>;
+        thread_local const int threadId = m_nextThreadId.fetch_add(1);
+        std::lock_guard lock(m_mutex);
+        m_events.push_back({std::string(name), Micros(start - m_epoch).count(), Micros(end - start).count(), threadId});
+    }
+
+    // Written to $TRACE_FILE, or trace.json in the working directory. Load it in Perfetto or chrome://tracing
+    ~TraceLog() {
+        const char* envPath = std::getenv("TRACE_FILE");
+        const std::filesystem::path path = envPath ? envPath : "trace.json";
+        std::ofstream file(path);
+        if (!file) {
+            std::cerr << std::format("Cannot write trace file: {}\n", path.string());
+            return;
+        }
+        file << "{\"traceEvents\":[\n";
+        for (size_t i = 0; i < m_events.size(); ++i) {
+            const TraceEvent& event = m_events[i];
+            file << std::format("{{\"name\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":1,\"tid\":{}}}{}\n",
+                EscapeJson(event.name), event.startMicros, event.durationMicros, event.threadId, i + 1 < m_events.size() ? "," : "");
+        }
+        file << "]}\n";
+    }
+
+private:
+    static std::string EscapeJson(std::string_view str) {
+        std::string escaped;
+        for (char c : str) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    std::chrono::steady_clock::time_point m_epoch{std::chrono::steady_clock::now()};
+    std::atomic<int> m_nextThreadId{0};
+    std::mutex m_mutex;
+    std::vector<TraceEvent> m_events;
+};
+
+TraceLog traceLog;
+
+} // namespace
+
+void RecordTraceSpan(std::string_view name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    traceLog.Add(name, start, end);
+}
+#endif
+
 } // namespace Util
+
+#ifdef ALLOC_STATS
+// Over-aligned allocations keep using the default operators and are not counted
+void* operator new(size_t size) { return Util::CountedAlloc(size); }
+void* operator new[](size_t size) { return Util::CountedAlloc(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return Util::CountedAlloc(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+
+void operator delete(void* ptr) noexcept { Util::CountedFree(ptr); }
+void operator delete[](void* ptr) noexcept { Util::CountedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { Util::CountedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { Util::CountedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { Util::CountedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { Util::CountedFree(ptr); }
+#endif